@@ -0,0 +1,433 @@
+/**
+ * Micro-benchmarks of the remote memory access strategies, on the access patterns of the il2cpp code:
+ *  - pointer chases (e.g. read(obj, out, off_1, off_2, ...)), where each read depends on the previous one
+ *  - scattered reads of independent class headers (e.g. the candidates of the .data scan)
+ *  - bulk reads of a whole PE section
+ *  - sparse lookups into a large region (e.g. global-metadata.dat read from the game's memory)
+ *
+ * The benchmarks are run against a child process that is forked after the data has been laid out, so that it's at the
+ * same addresses in both processes. Each case reports the average wall time and the number of syscalls per operation.
+ *
+ * Linux only (it relies on fork, and only the Linux backends have multiple access strategies to compare).
+ */
+
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "rpm.h"
+#include "rpm_backends.h"
+#include "remote_view.h"
+
+static constexpr size_t PAGE_SIZE = PageResidency::PAGE_SIZE;
+
+// Pointer chases: like Il2CppObject -> Il2CppClass -> static fields -> value
+static constexpr size_t CHASE_CHAINS = 64;
+static constexpr size_t CHASE_DEPTH = 4;
+static constexpr size_t CHASE_NEXT_OFFSET = 0x10;
+static constexpr size_t CHASE_VALUE_OFFSET = 0x18;
+
+// Class header reads (see: Il2CppClassHeader)
+static constexpr size_t HEADER_COUNT = WinRPM::ASYNC_QUEUE_DEPTH;
+static constexpr size_t HEADER_SIZE = 48;
+
+// Bulk reads: about the size of the .data section of GameAssembly.dll
+static constexpr size_t BULK_SIZE = 8 * 1024 * 1024;
+
+// Sparse lookups: one value from every n-th page of the bulk region
+static constexpr size_t SPARSE_STRIDE = 16 * PAGE_SIZE;
+
+// Each case is repeated for at least this long
+static constexpr auto MIN_DURATION = std::chrono::milliseconds(200);
+
+/**
+ * The data that the benchmarks read from the child process. Every node and header gets a page of its own, so that
+ * neither the kernel, nor the page cache can serve multiple of them at once.
+ */
+struct Fixture {
+  std::vector<uintptr_t> chainHeads;
+  std::vector<uint64_t> chainValues;
+  std::vector<uintptr_t> headers;
+  uintptr_t bulk = 0;
+
+  std::vector<void*> allocations;
+
+  Fixture()
+  {
+    for (size_t chain = 0; chain < CHASE_CHAINS; ++chain) {
+      uintptr_t next = 0;
+      for (size_t depth = 0; depth < CHASE_DEPTH; ++depth) {
+        const auto node = (unsigned char*)this->allocPages(PAGE_SIZE);
+        if (!next) {
+          chainValues.push_back(0x1000000ull * chain + 0x1234);
+          ::memcpy(node + CHASE_VALUE_OFFSET, &chainValues.back(), sizeof(uint64_t));
+        }
+        ::memcpy(node + CHASE_NEXT_OFFSET, &next, sizeof(next));
+        next = (uintptr_t)node;
+      }
+      chainHeads.push_back(next);
+    }
+
+    for (size_t idx = 0; idx < HEADER_COUNT; ++idx) {
+      const auto header = (unsigned char*)this->allocPages(PAGE_SIZE);
+      ::memset(header, (int)idx, HEADER_SIZE);
+      headers.push_back((uintptr_t)header);
+    }
+
+    // Touch every page, so that none of them reads as zero page
+    bulk = (uintptr_t)this->allocPages(BULK_SIZE);
+    for (size_t offset = 0; offset < BULK_SIZE; offset += sizeof(uint64_t))
+      *(uint64_t*)(bulk + offset) = offset;
+  }
+
+  ~Fixture()
+  {
+    for (void* allocation : allocations)
+      std::free(allocation);
+  }
+
+  Fixture(const Fixture&) = delete;
+  Fixture& operator=(const Fixture&) = delete;
+
+  void* allocPages(size_t size)
+  {
+    void* allocation = std::aligned_alloc(PAGE_SIZE, size);
+    ::memset(allocation, 0, size);
+    allocations.push_back(allocation);
+    return allocation;
+  }
+};
+
+/**
+ * A forked copy of ourselves that just sits there until we're done.
+ */
+class Child
+{
+  pid_t m_pid = -1;
+  int m_pipe = -1;
+
+public:
+  bool spawn()
+  {
+    int pipeFds[2];
+    if (::pipe(pipeFds) != 0)
+      return false;
+
+    m_pid = ::fork();
+    if (m_pid == 0) {
+      ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+      ::close(pipeFds[1]);
+      char c;
+      while (::read(pipeFds[0], &c, 1) != 0) {}
+      ::_exit(0);
+    }
+
+    ::close(pipeFds[0]);
+    m_pipe = pipeFds[1];
+    return m_pid > 0;
+  }
+
+  ~Child()
+  {
+    if (m_pipe >= 0)
+      ::close(m_pipe);
+    if (m_pid > 0)
+      ::waitpid(m_pid, nullptr, 0);
+  }
+
+  inline PID getPID() const { return (PID)m_pid; }
+};
+
+struct Measurement {
+  double nsPerOp;
+  double syscallsPerOp;
+  size_t failures;
+};
+
+/**
+ * Repeats an iteration (which carries out opsPerIter operations, and returns the number of failed ones) for at least
+ * MIN_DURATION, after a warm up iteration.
+ */
+static Measurement measure(
+  size_t opsPerIter, const std::function<size_t()>& iteration, const std::function<uint64_t()>& syscalls
+)
+{
+  size_t failures = iteration();
+
+  const uint64_t startSyscalls = syscalls();
+  const auto start = std::chrono::steady_clock::now();
+  size_t iterations = 0;
+  std::chrono::steady_clock::duration elapsed;
+  do {
+    failures += iteration();
+    ++iterations;
+    elapsed = std::chrono::steady_clock::now() - start;
+  } while (elapsed < MIN_DURATION);
+
+  const double ops = (double)iterations * opsPerIter;
+  return {
+    std::chrono::duration<double, std::nano>(elapsed).count() / ops, (double)(syscalls() - startSyscalls) / ops,
+    failures
+  };
+}
+
+static void report(std::string_view pattern, std::string_view strategy, const Measurement& measurement)
+{
+  std::cout << std::format(
+    "{:<14} {:<32} {:>14.1f} {:>14.3f}{}\n", pattern, strategy, measurement.nsPerOp, measurement.syscallsPerOp,
+    measurement.failures ? std::format("  ({} failures)", measurement.failures) : ""
+  );
+}
+
+// -------------------------------------------------------------------
+// - Patterns
+// -------------------------------------------------------------------
+
+/**
+ * One operation: a whole pointer chase. An iteration (i.e. a fix tick) chases every chain, starting a new epoch, so
+ * that the page cache has to revalidate what it has read during the previous one.
+ */
+template <typename RPM>
+static Measurement benchChase(RPM& rpm, const Fixture& fixture)
+{
+  return measure(
+    CHASE_CHAINS,
+    [&]() {
+      if constexpr (std::is_same_v<RPM, WinRPM>)
+        rpm.beginEpoch();
+      size_t failures = 0;
+      for (size_t chain = 0; chain < CHASE_CHAINS; ++chain) {
+        uint64_t value = 0;
+        if (!rpm.read(
+              fixture.chainHeads[chain], value, CHASE_NEXT_OFFSET, CHASE_NEXT_OFFSET, CHASE_NEXT_OFFSET,
+              CHASE_VALUE_OFFSET
+            ) ||
+            value != fixture.chainValues[chain])
+          ++failures;
+      }
+      return failures;
+    },
+    [&]() { return rpm.getSyscallCount(); }
+  );
+}
+
+/**
+ * One operation: a class header read, one by one.
+ */
+template <typename RPM>
+static Measurement benchHeadersSync(RPM& rpm, const Fixture& fixture)
+{
+  std::vector<unsigned char> buffer(HEADER_SIZE);
+  return measure(
+    HEADER_COUNT,
+    [&]() {
+      if constexpr (std::is_same_v<RPM, WinRPM>)
+        rpm.beginEpoch();
+      size_t failures = 0;
+      for (size_t idx = 0; idx < HEADER_COUNT; ++idx) {
+        if (!rpm.read_raw(fixture.headers[idx], buffer.data(), HEADER_SIZE) || buffer[0] != (unsigned char)idx)
+          ++failures;
+      }
+      return failures;
+    },
+    [&]() { return rpm.getSyscallCount(); }
+  );
+}
+
+/**
+ * One operation: a class header read, all of them in a single batch.
+ */
+template <typename RPM>
+static Measurement benchHeadersBatch(RPM& rpm, const Fixture& fixture)
+{
+  std::vector<unsigned char> buffer(HEADER_COUNT * HEADER_SIZE);
+  std::vector<WinRPM::ReadRequest> requests(HEADER_COUNT);
+  return measure(
+    HEADER_COUNT,
+    [&]() {
+      for (size_t idx = 0; idx < HEADER_COUNT; ++idx)
+        requests[idx] = {fixture.headers[idx], &buffer[idx * HEADER_SIZE], HEADER_SIZE};
+      rpm.read_batch(requests);
+      size_t failures = 0;
+      for (size_t idx = 0; idx < HEADER_COUNT; ++idx) {
+        if (!requests[idx].ok || buffer[idx * HEADER_SIZE] != (unsigned char)idx)
+          ++failures;
+      }
+      return failures;
+    },
+    [&]() { return rpm.getSyscallCount(); }
+  );
+}
+
+/**
+ * One operation: a class header read, all of them submitted asynchronously, then reaped together.
+ */
+template <typename RPM>
+static Measurement benchHeadersAsync(RPM& rpm, const Fixture& fixture)
+{
+  std::vector<unsigned char> buffer(HEADER_COUNT * HEADER_SIZE);
+  std::vector<WinRPM::AsyncRequest> requests(HEADER_COUNT);
+  return measure(
+    HEADER_COUNT,
+    [&]() {
+      for (size_t idx = 0; idx < HEADER_COUNT; ++idx) {
+        requests[idx] = {fixture.headers[idx], &buffer[idx * HEADER_SIZE], HEADER_SIZE};
+        rpm.async_submit(requests[idx]);
+      }
+      rpm.async_reap();
+      size_t failures = 0;
+      for (size_t idx = 0; idx < HEADER_COUNT; ++idx) {
+        if (!requests[idx].ok || buffer[idx * HEADER_SIZE] != (unsigned char)idx)
+          ++failures;
+      }
+      return failures;
+    },
+    [&]() { return rpm.getSyscallCount(); }
+  );
+}
+
+/**
+ * One operation: a bulk read, in a single request.
+ */
+template <typename RPM>
+static Measurement benchBulkSingle(RPM& rpm, const Fixture& fixture)
+{
+  auto buffer = std::make_unique_for_overwrite<unsigned char[]>(BULK_SIZE);
+  return measure(
+    1,
+    [&]() -> size_t {
+      return !rpm.read_raw(fixture.bulk, buffer.get(), BULK_SIZE) ||
+             *(uint64_t*)&buffer[BULK_SIZE - sizeof(uint64_t)] != BULK_SIZE - sizeof(uint64_t);
+    },
+    [&]() { return rpm.getSyscallCount(); }
+  );
+}
+
+/**
+ * One operation: a bulk read, in parallel chunks (see: WinRPM::read_large).
+ */
+static Measurement benchBulkLarge(WinRPM& rpm, const Fixture& fixture, unsigned maxThreads)
+{
+  auto buffer = std::make_unique_for_overwrite<unsigned char[]>(BULK_SIZE);
+  return measure(
+    1,
+    [&]() -> size_t {
+      const auto result =
+        rpm.read_large(fixture.bulk, buffer.get(), BULK_SIZE, nullptr, LargeReadResult::DEFAULT_CHUNK_SIZE, maxThreads);
+      return !result.ok() || *(uint64_t*)&buffer[BULK_SIZE - sizeof(uint64_t)] != BULK_SIZE - sizeof(uint64_t);
+    },
+    [&]() { return rpm.getSyscallCount(); }
+  );
+}
+
+/**
+ * Checks the values of the sparse lookups in a local copy of the bulk region. Returns the number of wrong ones.
+ */
+static size_t checkSparse(const unsigned char* bulk)
+{
+  size_t failures = 0;
+  for (size_t offset = 0; offset < BULK_SIZE; offset += SPARSE_STRIDE) {
+    if (*(const volatile uint64_t*)&bulk[offset] != offset)
+      ++failures;
+  }
+  return failures;
+}
+
+/**
+ * One operation: the sparse lookups, after reading the whole region up front (see: WinRPM::read_large).
+ */
+static Measurement benchSparseLarge(WinRPM& rpm, const Fixture& fixture)
+{
+  auto buffer = std::make_unique_for_overwrite<unsigned char[]>(BULK_SIZE);
+  return measure(
+    1,
+    [&]() -> size_t {
+      rpm.read_large(fixture.bulk, buffer.get(), BULK_SIZE);
+      return checkSparse(buffer.get());
+    },
+    [&]() { return rpm.getSyscallCount(); }
+  );
+}
+
+/**
+ * One operation: the sparse lookups, through a lazy view of the region (see: RemoteView), which is set up and torn
+ * down each time.
+ */
+static Measurement benchSparseView(WinRPM& rpm, const Fixture& fixture)
+{
+  RemoteView view;
+  return measure(
+    1,
+    [&]() -> size_t {
+      if (!view.open(rpm, {fixture.bulk, fixture.bulk + BULK_SIZE}, false))
+        return BULK_SIZE / SPARSE_STRIDE;
+      const size_t failures = checkSparse(view.data());
+      view.close();
+      return failures;
+    },
+    [&]() { return rpm.getSyscallCount(); }
+  );
+}
+
+int main()
+{
+  const Fixture fixture;
+  Child child;
+  if (!child.spawn()) {
+    std::cout << "[Error]: Couldn't spawn the child process.\n";
+    return 1;
+  }
+
+  WinRPM rpm;
+  WinRPM cachedRpm;
+  VmReadvRPM vmRpm;
+  if (rpm.open(child.getPID()) != WinRPM::OpenResult::Ok ||
+      cachedRpm.open(child.getPID()) != WinRPM::OpenResult::Ok ||
+      vmRpm.open(child.getPID()) != WinRPM::OpenResult::Ok) {
+    std::cout << "[Error]: Couldn't open the child process (missing ptrace permissions?).\n";
+    return 1;
+  }
+  cachedRpm.enablePageCache(1024);
+
+  std::cout << std::format("{:<14} {:<32} {:>14} {:>14}\n", "pattern", "strategy", "ns/op", "syscalls/op");
+
+  const auto chase = std::format("chase x{}", CHASE_DEPTH);
+  report(chase, "pread", benchChase(rpm, fixture));
+  report(chase, "pread + page cache", benchChase(cachedRpm, fixture));
+  report(chase, "process_vm_readv", benchChase(vmRpm, fixture));
+
+  const auto header = std::format("header {}B", HEADER_SIZE);
+  report(header, "pread", benchHeadersSync(rpm, fixture));
+  report(header, "pread + page cache", benchHeadersSync(cachedRpm, fixture));
+  report(header, "process_vm_readv", benchHeadersSync(vmRpm, fixture));
+  report(header, std::format("read_batch x{}", HEADER_COUNT), benchHeadersBatch(rpm, fixture));
+  report(header, std::format("async x{}", HEADER_COUNT), benchHeadersAsync(rpm, fixture));
+
+  const auto bulk = std::format("bulk {}MiB", BULK_SIZE / (1024 * 1024));
+  report(bulk, "pread", benchBulkSingle(rpm, fixture));
+  report(bulk, "process_vm_readv", benchBulkSingle(vmRpm, fixture));
+  report(bulk, "read_large (1 thread)", benchBulkLarge(rpm, fixture, 1));
+  report(bulk, "read_large", benchBulkLarge(rpm, fixture, 0));
+
+  const auto sparse = std::format("sparse 1/{}", SPARSE_STRIDE / PAGE_SIZE);
+  report(sparse, "read_large", benchSparseLarge(rpm, fixture));
+  if (RemoteView view; view.open(rpm, {fixture.bulk, fixture.bulk + BULK_SIZE}, false)) {
+    view.close();
+    report(sparse, "RemoteView (lazy)", benchSparseView(rpm, fixture));
+  } else {
+    std::cout << std::format("{:<14} userfaultfd is not permitted, skipping the RemoteView cases\n", sparse);
+  }
+
+  return 0;
+}
\ No newline at end of file
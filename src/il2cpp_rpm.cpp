@@ -2,6 +2,7 @@
 #define _SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING
 
 #include <array>
+#include <chrono>
 #include <thread>
 #include <iostream>
 #include <fstream>
@@ -21,39 +22,71 @@
 #define LOG_VERBF(...) if (m_verbose) std::cerr << std::format(__VA_ARGS__)
 // clang-format on
 
-Il2CppRPM::OpenResult Il2CppRPM::open(WinRPM::PathViewType processName)
+template <RPMBackend RPM>
+Il2CppOpenResult BasicIl2CppRPM<RPM>::open(WinRPM::PathViewType processName)
 {
   if (const auto openResult = m_rpm.open(processName); openResult != WinRPM::OpenResult::Ok)
-    return (Il2CppRPM::OpenResult)openResult;
+    return (Il2CppOpenResult)openResult;
+  return this->attach();
+}
+
+template <RPMBackend RPM>
+Il2CppOpenResult BasicIl2CppRPM<RPM>::open(PID pid)
+{
+  if (const auto openResult = m_rpm.open(pid); openResult != WinRPM::OpenResult::Ok)
+    return (Il2CppOpenResult)openResult;
+  return this->attach();
+}
+
+template <RPMBackend RPM>
+Il2CppOpenResult BasicIl2CppRPM<RPM>::attach()
+{
+  const rpm_stats::ScopedTag statsTag(rpm_stats::TAG_ATTACH);
 
   // Get the base address of GameAssembly.dll and global-metadata.dat
-  m_gameAssemblyBase = m_rpm.getModuleInfo(WINRPM_PATH("GameAssembly.dll")).base;
+  //  Both are file backed memory regions (even the module), so they can be found in a single pass.
+  constexpr WinRPM::PathViewType wantedFiles[] = {WINRPM_PATH("GameAssembly.dll"), WINRPM_PATH("global-metadata.dat")};
+  const auto mappedFiles = m_rpm.getMappedFileInfos(wantedFiles);
+  m_gameAssemblyBase = mappedFiles[0].range.start;
   if (!m_gameAssemblyBase) {
     LOG_VERB("[Error]: Couldn't find the base address of 'GameAssembly.dll'.\n");
     this->close();
-    return Il2CppRPM::OpenResult::Il2CppError;
+    return Il2CppOpenResult::Il2CppError;
   }
 
-  const auto globalMetadata = m_rpm.getMappedFileInfo(WINRPM_PATH("global-metadata.dat"));
+  const auto& globalMetadata = mappedFiles[1];
   if (!(m_metadataRange = globalMetadata.range)) {
     LOG_VERB("[Error]: Couldn't find the address of 'global-metadata.dat'.\n");
     this->close();
-    return Il2CppRPM::OpenResult::Il2CppError;
+    return Il2CppOpenResult::Il2CppError;
   }
 
-  if (!m_metadataView.open(globalMetadata.path)) {
-    LOG_VERBF("[Error]: Couldn't map 'global-metadata.dat' into memory (path: '{}')\n", globalMetadata.path.string());
-    this->close();
-    return Il2CppRPM::OpenResult::Il2CppError;
-  }
-
-  if (m_metadataView.mappedSize() != m_metadataRange.size()) {
+  // Use the local file, unless it's unavailable, or it doesn't match what the game has loaded (e.g. it has been
+  // updated since)
+  bool useLocal = m_metadataView.open(globalMetadata.path, MmapView::MapMode::Lazy);
+  m_metadataRemote.close();
+  if (!useLocal) {
     LOG_VERBF(
-      "[Error]: Memory mapped sizes differ: [local: {:#016x}, remote: {:#016x}]\n", m_metadataView.mappedSize(),
+      "[Warning]: Couldn't map 'global-metadata.dat' into memory (path: '{}').\n", globalMetadata.path.string()
+    );
+  } else if (m_metadataView.mappedSize() != m_metadataRange.size()) {
+    LOG_VERBF(
+      "[Warning]: Memory mapped sizes differ: [local: {:#016x}, remote: {:#016x}]\n", m_metadataView.mappedSize(),
       m_metadataRange.size()
     );
-    this->close();
-    return Il2CppRPM::OpenResult::Il2CppError;
+    useLocal = false;
+  } else if (!this->meta_verifySample()) {
+    LOG_VERB("[Warning]: The local 'global-metadata.dat' differs from the one loaded by the game.\n");
+    useLocal = false;
+  }
+
+  if (!useLocal) {
+    LOG_VERB("[Info]: Reading 'global-metadata.dat' from the game's memory instead.\n");
+    if (!this->meta_loadFromRemote()) {
+      LOG_VERB("[Error]: Couldn't read 'global-metadata.dat' from the game's memory.\n");
+      this->close();
+      return Il2CppOpenResult::Il2CppError;
+    }
   }
 
   // Validate header
@@ -63,14 +96,29 @@ Il2CppRPM::OpenResult Il2CppRPM::open(WinRPM::PathViewType processName)
   if (metaHeader.sanity != 0xFAB11BAF) {
     LOG_VERBF("[Error]: Invalid magic. [Expected: 0xFAB11BAF, got: {:#016}]\n", metaHeader.sanity);
     this->close();
-    return Il2CppRPM::OpenResult::Il2CppError;
+    return Il2CppOpenResult::Il2CppError;
   }
 
   // Check version
   if (metaHeader.version < 29) {
     LOG_VERBF("[Error]: Expected version >= 29. [got: {}]\n", metaHeader.version);
     this->close();
-    return Il2CppRPM::OpenResult::Il2CppError;
+    return Il2CppOpenResult::Il2CppError;
+  }
+
+  // Prefetch the tables that we are going to read
+  for (const auto& [offsetField, sizeField] : META_USED_TABLES) {
+    if (metaHeader.*offsetField >= 0 && metaHeader.*sizeField > 0)
+      m_metadataView.willNeed(metaHeader.*offsetField, metaHeader.*sizeField);
+  }
+
+  // Index the types by their names. Without the index, the names are compared one by one instead.
+  const auto indexStart = std::chrono::steady_clock::now();
+  if (m_typeIndex.build(m_metadataView)) {
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - indexStart;
+    LOG_VERBF("[Debug]: Indexed {} types in {:.1f} ms.\n", m_typeIndex.size(), elapsed.count());
+  } else {
+    LOG_VERB("[Warning]: Couldn't index the types of the metadata.\n");
   }
 
   LOG_CERRF("[Info]: Opened il2cpp process [PID: {}].\n", m_rpm.getPID());
@@ -79,13 +127,105 @@ Il2CppRPM::OpenResult Il2CppRPM::open(WinRPM::PathViewType processName)
     metaHeader.version, m_gameAssemblyBase, m_metadataRange.start, m_metadataRange.end
   );
 
-  return Il2CppRPM::OpenResult::Ok;
+  return Il2CppOpenResult::Ok;
 }
 
-void Il2CppRPM::close()
+template <RPMBackend RPM>
+bool BasicIl2CppRPM<RPM>::meta_verifySample()
 {
-  m_rpm.close();
+  constexpr size_t PAGE_SIZE = PageResidency::PAGE_SIZE;
+  const auto start = std::chrono::steady_clock::now();
+
+  // Sample pages evenly spread across the file, always including the first and the last one
+  const size_t numPages = m_metadataRange.size() / PAGE_SIZE;
+  const size_t numSamples = std::min(META_VERIFY_SAMPLES, numPages);
+  auto remotePages = std::make_unique_for_overwrite<unsigned char[]>(numSamples * PAGE_SIZE);
+  std::array<WinRPM::ReadRequest, META_VERIFY_SAMPLES> requests;
+  for (size_t idx = 0; idx < numSamples; ++idx) {
+    const size_t page = numSamples > 1 ? idx * (numPages - 1) / (numSamples - 1) : 0;
+    requests[idx] = {m_metadataRange.start + page * PAGE_SIZE, &remotePages[idx * PAGE_SIZE], PAGE_SIZE};
+  }
+  m_rpm.read_batch(std::span{requests.data(), numSamples});
+
+  // Unreadable remote pages can't tell anything, so they are skipped
+  size_t numCompared = 0;
+  for (size_t idx = 0; idx < numSamples; ++idx) {
+    const auto& request = requests[idx];
+    if (!request.ok)
+      continue;
+    ++numCompared;
+    if (::memcmp(request.dataOut, &m_metadataView[request.remoteAddr - m_metadataRange.start], PAGE_SIZE) != 0) {
+      LOG_VERBF("[Debug]: 'global-metadata.dat' differs at {:#x}.\n", request.remoteAddr - m_metadataRange.start);
+      return false;
+    }
+  }
+
+  // Nothing has been verified, so the local file can't be trusted
+  if (!numCompared) {
+    LOG_VERB("[Debug]: None of the sampled pages of 'global-metadata.dat' could be read from the game.\n");
+    return false;
+  }
+
+  const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  LOG_VERBF(
+    "[Debug]: Verified {}/{} sampled pages of 'global-metadata.dat' in {:.3f} ms.\n", numCompared, numSamples,
+    elapsed.count()
+  );
+  return true;
+}
+
+template <RPMBackend RPM>
+bool BasicIl2CppRPM<RPM>::meta_loadFromRemote()
+{
+  const auto start = std::chrono::steady_clock::now();
+
+  // The header is a must, so it's fetched right away
+  if (m_metadataRemote.open(m_rpm, m_metadataRange, false)) {
+    const auto data = m_metadataRemote.remoteToLocal<unsigned char>(m_metadataRange.start);
+    (void)*(const volatile unsigned char*)data;
+    if (m_metadataRemote.getFailedPages() == 0) {
+      m_metadataView.wrap(data, m_metadataRange.size());
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      LOG_VERBF(
+        "[Debug]: Viewing 'global-metadata.dat' in the game's memory lazily ({:.1f} MiB, set up in {:.1f} ms).\n",
+        m_metadataRange.size() / (1024.0 * 1024.0), elapsed.count()
+      );
+      return true;
+    }
+    m_metadataRemote.close();
+  }
+
+  unsigned char* arena = m_metadataView.allocate(m_metadataRange.size());
+  if (!arena)
+    return false;
+
+  // Unreadable chunks are zeroed out, so lookups into them simply fail, but the header is a must
+  const auto result = m_rpm.read_large(m_metadataRange.start, arena, m_metadataRange.size());
+  if (!result.isOk(m_metadataRange.start, sizeof(il2cpp::Il2CppGlobalMetadataHeader))) {
+    m_metadataView.close();
+    return false;
+  }
+
+  const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  LOG_VERBF(
+    "[Debug]: Read 'global-metadata.dat' from the game's memory in {:.1f} ms ({:.1f} MiB, {}/{} chunks).\n",
+    elapsed.count(), m_metadataRange.size() / (1024.0 * 1024.0), result.numOk, result.chunkCount()
+  );
+  if (result.numFailed())
+    LOG_VERBF("[Warning]: {} chunks of 'global-metadata.dat' couldn't be read.\n", result.numFailed());
+  return true;
+}
+
+template <RPMBackend RPM>
+void BasicIl2CppRPM<RPM>::close()
+{
+  // The lazy metadata view uses the backend, so it has to go first
   m_metadataView.close();
+  m_metadataRemote.close();
+  m_rpm.close();
+  m_typeIndex.clear();
+  m_typeInfoTable = {};
+  m_regions.clear();
   m_gameAssemblyBase = {};
   m_metadataRange = {};
 }
@@ -100,10 +240,45 @@ inline static size_t strnlen_s_impl(const char* str, size_t strsz)
 #endif
 }
 
+template <RPMBackend RPM>
+std::optional<uint32_t> BasicIl2CppRPM<RPM>::meta_getTypedefIdx(uintptr_t typedefPtr) const
+{
+  const auto& header = this->meta_getHeader();
+  const uintptr_t tableStart = m_metadataRange.start + header.typeDefinitionsOffset;
+  if (typedefPtr < tableStart || (typedefPtr - tableStart) % sizeof(il2cpp::Il2CppTypeDefinition) != 0)
+    return {};
+  const uintptr_t idx = (typedefPtr - tableStart) / sizeof(il2cpp::Il2CppTypeDefinition);
+  if (idx >= header.typeDefinitionsSize / sizeof(il2cpp::Il2CppTypeDefinition))
+    return {};
+  return (uint32_t)idx;
+}
+
+template <RPMBackend RPM>
+std::optional<Il2CppInternedId> BasicIl2CppRPM<RPM>::meta_internId(const Il2CppId& id) const
+{
+  const auto& header = this->meta_getHeader();
+  const uintptr_t stringTable = m_metadataRange.start + header.stringOffset;
+
+  std::optional<Il2CppInternedId> interned;
+  for (const uint32_t typedefIdx : this->meta_findTypedefs(id)) {
+    const auto typedefInst = this->meta_getLocalByIdx<il2cpp::Il2CppTypeDefinition>(
+      header.typeDefinitionsOffset, header.typeDefinitionsSize, typedefIdx * sizeof(il2cpp::Il2CppTypeDefinition)
+    );
+    if (!typedefInst)
+      return {};
+    const Il2CppInternedId typedefId{stringTable + typedefInst->nameIndex, stringTable + typedefInst->namespaceIndex};
+    if (interned && (interned->name != typedefId.name || interned->namespaze != typedefId.namespaze))
+      return {};
+    interned = typedefId;
+  }
+  return interned;
+}
+
 /**
  * Gets a string from the metadata's string table.
  */
-std::optional<std::string_view> Il2CppRPM::meta_getStrByIdx(uintptr_t index, size_t maxLen) const
+template <RPMBackend RPM>
+std::optional<std::string_view> BasicIl2CppRPM<RPM>::meta_getStrByIdx(uintptr_t index, size_t maxLen) const
 {
   const auto& header = this->meta_getHeader();
   if (const auto strPtr = this->meta_getLocalByIdx<const char>(header.stringOffset, header.stringSize, index))
@@ -115,40 +290,156 @@ std::optional<std::string_view> Il2CppRPM::meta_getStrByIdx(uintptr_t index, siz
  * Maps a remote string pointer inside the remote global-metadata.dat to a local pointer inside our own mapped
  * version of global-metadata.dat .
  */
-std::optional<std::string_view> Il2CppRPM::meta_remoteStrToLocal(uintptr_t remotePtr, size_t maxLen) const
+template <RPMBackend RPM>
+std::optional<std::string_view> BasicIl2CppRPM<RPM>::meta_remoteStrToLocal(uintptr_t remotePtr, size_t maxLen) const
 {
   if (const auto strPtr = this->meta_ptrToLocal<const char>(remotePtr))
     return std::string_view{strPtr, strnlen_s_impl(strPtr, maxLen)};
   return {};
 }
 
-bool Il2CppRPM::il2cpp_class_heuristicCheck(uintptr_t classPtr, Il2CppId& classId)
+/**
+ * The classes that are checked in the type info table candidates.
+ */
+static constexpr Il2CppId TYPE_INFO_TABLE_ANCHORS[] = {{"Object", "System"}, {"String", "System"}};
+
+template <RPMBackend RPM>
+bool BasicIl2CppRPM<RPM>::il2cpp_setTypeInfoTable(uintptr_t table)
+{
+  for (const auto& anchor : TYPE_INFO_TABLE_ANCHORS) {
+    const auto typedefs = this->meta_findTypedefs(anchor);
+    const auto interned = this->meta_internId(anchor);
+    if (typedefs.empty() || !interned)
+      return false;
+
+    uintptr_t classPtr;
+    Il2CppClassHeader classHeader;
+    if (!m_rpm.read(table, classPtr, typedefs[0] * sizeof(uintptr_t)) ||
+        !this->isReadableRemotePtr(classPtr, sizeof(classHeader)) || !m_rpm.read(classPtr, classHeader))
+      return false;
+    // System.Object and System.String aren't IL2CPP_TYPE_CLASS types, so only their names are checked
+    if (classHeader.name != interned->name || classHeader.namespaze != interned->namespaze)
+      return false;
+  }
+
+  m_typeInfoTable = table;
+  return true;
+}
+
+template <RPMBackend RPM>
+uintptr_t BasicIl2CppRPM<RPM>::il2cpp_locateTypeInfoTable(
+  const unsigned char* data, size_t dataSize, uintptr_t remoteAddr
+)
+{
+  // Without the regions, there's no telling which pointers point to a large enough allocation, so every pointer
+  // would have to be checked
+  const auto& anchor = TYPE_INFO_TABLE_ANCHORS[0];
+  const auto typedefs = this->meta_findTypedefs(anchor);
+  const auto interned = this->meta_internId(anchor);
+  if (m_regions.empty() || !m_typeIndex || typedefs.empty() || !interned)
+    return 0;
+  const size_t tableSize = m_typeIndex.size() * sizeof(uintptr_t);
+  const size_t anchorOffset = typedefs[0] * sizeof(uintptr_t);
+
+  struct Candidate {
+    uintptr_t slot{};
+    uintptr_t table{};
+    uintptr_t classPtr{};
+    Il2CppClassHeader header{};
+  };
+  std::vector<Candidate> window;
+  std::vector<WinRPM::ReadRequest> requests;
+  window.reserve(WinRPM::ASYNC_QUEUE_DEPTH);
+  requests.reserve(WinRPM::ASYNC_QUEUE_DEPTH);
+
+  for (size_t offset = 0; offset + sizeof(uintptr_t) <= dataSize;) {
+    // Collect the pointers to allocations that could hold the table
+    window.clear();
+    for (; offset + sizeof(uintptr_t) <= dataSize && window.size() < WinRPM::ASYNC_QUEUE_DEPTH;
+         offset += sizeof(uintptr_t)) {
+      const uintptr_t table = *(const uintptr_t*)&data[offset];
+      if (table % sizeof(uintptr_t) == 0 && this->isReadableRemotePtr(table, tableSize))
+        window.push_back({remoteAddr + offset, table});
+    }
+
+    // Read the class pointers of the first anchor from them, then the class headers that they point to
+    requests.clear();
+    for (auto& candidate : window)
+      requests.push_back({candidate.table + anchorOffset, &candidate.classPtr, sizeof(uintptr_t)});
+    m_rpm.read_batch(requests);
+
+    size_t numRequests = 0;
+    for (size_t idx = 0; idx < window.size(); ++idx) {
+      auto& candidate = window[idx];
+      if (requests[idx].ok && this->isReadableRemotePtr(candidate.classPtr, sizeof(Il2CppClassHeader)))
+        requests[numRequests++] = {candidate.classPtr, &candidate.header, sizeof(Il2CppClassHeader)};
+      else
+        candidate.classPtr = 0;
+    }
+    requests.resize(numRequests);
+    m_rpm.read_batch(requests);
+
+    // The requests follow the candidates whose class pointers were kept, in order
+    auto request = requests.begin();
+    for (const auto& candidate : window) {
+      if (!candidate.classPtr || !(request++)->ok)
+        continue;
+      if (candidate.header.name == interned->name && candidate.header.namespaze == interned->namespaze &&
+          this->il2cpp_setTypeInfoTable(candidate.table))
+        return candidate.slot;
+    }
+  }
+  return 0;
+}
+
+template <RPMBackend RPM>
+uintptr_t BasicIl2CppRPM<RPM>::il2cpp_getClassByTypedefIdx(uint32_t typedefIdx)
+{
+  uintptr_t classPtr;
+  if (!m_typeInfoTable || typedefIdx >= m_typeIndex.size() ||
+      !m_rpm.read(m_typeInfoTable, classPtr, typedefIdx * sizeof(uintptr_t)))
+    return 0;
+  return classPtr;
+}
+
+template <RPMBackend RPM>
+uintptr_t BasicIl2CppRPM<RPM>::il2cpp_findClass(const Il2CppId& id)
+{
+  // The table is only validated by its anchors, so whatever it yields is checked too
+  for (const uint32_t typedefIdx : this->meta_findTypedefs(id)) {
+    const uintptr_t classPtr = this->il2cpp_getClassByTypedefIdx(typedefIdx);
+    if (classPtr && this->il2cpp_class_hasNameAndNamespace(classPtr, id))
+      return classPtr;
+  }
+  return 0;
+}
+
+template <RPMBackend RPM>
+bool BasicIl2CppRPM<RPM>::il2cpp_class_heuristicCheck(uintptr_t classPtr, Il2CppId& classId)
 {
   // Validate the remote pointer
-  if (!Il2CppRPM::isValidRemotePtr(classPtr))
+  Il2CppClassHeader classHeader;
+  if (!this->isReadableRemotePtr(classPtr, sizeof(classHeader)))
     return false;
 
   // Try and read the limited class header
-  struct {
-    uintptr_t image;     // void*
-    uintptr_t gc_desc;   // void*
-    uintptr_t name;      // const char*
-    uintptr_t namespaze; // const char*
-    il2cpp::Il2CppType byval_arg;
-    il2cpp::Il2CppType this_arg;
-  } classInst;
-  if (!m_rpm.read(classPtr, classInst))
+  if (!m_rpm.read(classPtr, classHeader))
     return false;
+  return this->il2cpp_class_heuristicCheck(classHeader, classId);
+}
 
+template <RPMBackend RPM>
+bool BasicIl2CppRPM<RPM>::il2cpp_class_heuristicCheck(const Il2CppClassHeader& classHeader, Il2CppId& classId) const
+{
   // Look for classes
-  if (classInst.byval_arg.type != il2cpp::Il2CppTypeEnum::IL2CPP_TYPE_CLASS ||
-      classInst.this_arg.type != il2cpp::Il2CppTypeEnum::IL2CPP_TYPE_CLASS)
+  if (classHeader.byval_arg.type != il2cpp::Il2CppTypeEnum::IL2CPP_TYPE_CLASS ||
+      classHeader.this_arg.type != il2cpp::Il2CppTypeEnum::IL2CPP_TYPE_CLASS)
     return false;
 
-  const auto nameView = this->meta_remoteStrToLocal(classInst.name);
+  const auto nameView = this->meta_remoteStrToLocal(classHeader.name);
   if (!nameView)
     return false;
-  const auto namespaceView = this->meta_remoteStrToLocal(classInst.namespaze);
+  const auto namespaceView = this->meta_remoteStrToLocal(classHeader.namespaze);
   if (!namespaceView)
     return false;
   classId.name = *nameView;
@@ -156,7 +447,8 @@ bool Il2CppRPM::il2cpp_class_heuristicCheck(uintptr_t classPtr, Il2CppId& classI
   return true;
 }
 
-uintptr_t Il2CppRPM::il2cpp_obj_getClassInstance(uintptr_t objPtr)
+template <RPMBackend RPM>
+uintptr_t BasicIl2CppRPM<RPM>::il2cpp_obj_getClassInstance(uintptr_t objPtr)
 {
   uintptr_t classPtr;
   if (!m_rpm.read(objPtr, classPtr, offsetof(il2cpp::Il2CppObject, klass)))
@@ -164,7 +456,8 @@ uintptr_t Il2CppRPM::il2cpp_obj_getClassInstance(uintptr_t objPtr)
   return classPtr;
 }
 
-std::optional<std::string_view> Il2CppRPM::il2cpp_class_getName(uintptr_t classPtr)
+template <RPMBackend RPM>
+std::optional<std::string_view> BasicIl2CppRPM<RPM>::il2cpp_class_getName(uintptr_t classPtr)
 {
   uintptr_t ptr;
   if (!m_rpm.read(classPtr, ptr, offsetof(il2cpp::Il2CppClass, name)))
@@ -172,7 +465,8 @@ std::optional<std::string_view> Il2CppRPM::il2cpp_class_getName(uintptr_t classP
   return this->meta_remoteStrToLocal(ptr, 512); // 512 is a hard limit in C# for identifiers.
 }
 
-std::optional<std::string_view> Il2CppRPM::il2cpp_class_getNamespace(uintptr_t classPtr)
+template <RPMBackend RPM>
+std::optional<std::string_view> BasicIl2CppRPM<RPM>::il2cpp_class_getNamespace(uintptr_t classPtr)
 {
   uintptr_t ptr;
   if (!m_rpm.read(classPtr, ptr, offsetof(il2cpp::Il2CppClass, namespaze)))
@@ -180,19 +474,30 @@ std::optional<std::string_view> Il2CppRPM::il2cpp_class_getNamespace(uintptr_t c
   return this->meta_remoteStrToLocal(ptr, 512); // 512 is a hard limit in C# for identifiers.
 }
 
-bool Il2CppRPM::il2cpp_class_hasNameAndNamespace(uintptr_t classPtr, const Il2CppId& id)
+template <RPMBackend RPM>
+bool BasicIl2CppRPM<RPM>::il2cpp_class_hasNameAndNamespace(uintptr_t classPtr, const Il2CppId& id)
 {
-  struct {
-    uintptr_t name;      // const char*
-    uintptr_t namespaze; // const char*
-  } classInst{};
-  if (!m_rpm.read(classPtr, classInst, offsetof(il2cpp::Il2CppClass, name)))
+  Il2CppClassHeader classHeader;
+  if (!m_rpm.read(classPtr, classHeader))
     return false;
-  return this->meta_remoteStrToLocal(classInst.name, 512) == id.name &&
-         this->meta_remoteStrToLocal(classInst.namespaze, 512) == id.namespaze;
+  return this->il2cpp_class_hasNameAndNamespace(classHeader, id);
+}
+
+template <RPMBackend RPM>
+bool BasicIl2CppRPM<RPM>::il2cpp_class_hasNameAndNamespace(const Il2CppClassHeader& classHeader, const Il2CppId& id)
+  const
+{
+  // The typedef of a class is the data of its byval_arg
+  if (m_typeIndex && classHeader.byval_arg.type == il2cpp::Il2CppTypeEnum::IL2CPP_TYPE_CLASS) {
+    if (const auto typedefIdx = this->meta_getTypedefIdx(classHeader.byval_arg.data))
+      return m_typeIndex.has(*typedefIdx, id.hash());
+  }
+  return this->meta_remoteStrToLocal(classHeader.name, 512) == id.name &&
+         this->meta_remoteStrToLocal(classHeader.namespaze, 512) == id.namespaze;
 }
 
-std::optional<std::string_view> Il2CppRPM::il2cpp_typedef_getName(uintptr_t typedefPtr)
+template <RPMBackend RPM>
+std::optional<std::string_view> BasicIl2CppRPM<RPM>::il2cpp_typedef_getName(uintptr_t typedefPtr)
 {
   uint32_t nameIndex;
   if (!m_rpm.read(typedefPtr, nameIndex, offsetof(il2cpp::Il2CppTypeDefinition, nameIndex)))
@@ -200,7 +505,8 @@ std::optional<std::string_view> Il2CppRPM::il2cpp_typedef_getName(uintptr_t type
   return this->meta_getStrByIdx(nameIndex);
 }
 
-std::optional<std::string_view> Il2CppRPM::il2cpp_typedef_getNamespace(uintptr_t typedefPtr)
+template <RPMBackend RPM>
+std::optional<std::string_view> BasicIl2CppRPM<RPM>::il2cpp_typedef_getNamespace(uintptr_t typedefPtr)
 {
   uint32_t namespaceIndex;
   if (!m_rpm.read(typedefPtr, namespaceIndex, offsetof(il2cpp::Il2CppTypeDefinition, namespaceIndex)))
@@ -208,8 +514,15 @@ std::optional<std::string_view> Il2CppRPM::il2cpp_typedef_getNamespace(uintptr_t
   return this->meta_getStrByIdx(namespaceIndex);
 }
 
-bool Il2CppRPM::il2cpp_typedef_hasNameAndNamespace(uintptr_t typedefPtr, const Il2CppId& id)
+template <RPMBackend RPM>
+bool BasicIl2CppRPM<RPM>::il2cpp_typedef_hasNameAndNamespace(uintptr_t typedefPtr, const Il2CppId& id)
 {
+  // The typedefs are in the metadata, so with the index, there's nothing to read
+  if (m_typeIndex) {
+    if (const auto typedefIdx = this->meta_getTypedefIdx(typedefPtr))
+      return m_typeIndex.has(*typedefIdx, id.hash());
+  }
+
   struct {
     uint32_t nameIndex;
     uint32_t namespaceIndex;
@@ -221,10 +534,13 @@ bool Il2CppRPM::il2cpp_typedef_hasNameAndNamespace(uintptr_t typedefPtr, const I
          this->meta_getStrByIdx(typedefInst.namespaceIndex) == id.namespaze;
 }
 
-void Il2CppRPM::il2cpp_class_enumFields(
+template <RPMBackend RPM>
+void BasicIl2CppRPM<RPM>::il2cpp_class_enumFields(
   uintptr_t classPtr, std::function<bool(const il2cpp::FieldInfo& field)> callback, uint16_t maxFields
 )
 {
+  const rpm_stats::ScopedTag statsTag(rpm_stats::TAG_ENUM_FIELDS);
+
   // Read the field count
   decltype(il2cpp::Il2CppClass::field_count) fieldCount{};
   if (!m_rpm.read(classPtr, fieldCount, offsetof(il2cpp::Il2CppClass, field_count)))
@@ -250,8 +566,10 @@ void Il2CppRPM::il2cpp_class_enumFields(
   return;
 }
 
-bool Il2CppRPM::il2cpp_string_readUTF16(uintptr_t strPtr, std::u16string& out)
+template <RPMBackend RPM>
+bool BasicIl2CppRPM<RPM>::il2cpp_string_readUTF16(uintptr_t strPtr, std::u16string& out)
 {
+  const rpm_stats::ScopedTag statsTag(rpm_stats::TAG_STRING_READ);
   il2cpp::Il2CppString str;
   if (!m_rpm.read(strPtr, str))
     return false;
@@ -259,7 +577,8 @@ bool Il2CppRPM::il2cpp_string_readUTF16(uintptr_t strPtr, std::u16string& out)
   return m_rpm.read_raw(strPtr + offsetof(il2cpp::Il2CppString, chars), out.data(), str.length * sizeof(str.chars[0]));
 }
 
-bool Il2CppRPM::il2cpp_string_readUTF8(uintptr_t strPtr, std::string& out)
+template <RPMBackend RPM>
+bool BasicIl2CppRPM<RPM>::il2cpp_string_readUTF8(uintptr_t strPtr, std::string& out)
 {
   std::u16string tmp;
   if (!this->il2cpp_string_readUTF16(strPtr, tmp))
@@ -272,10 +591,11 @@ bool Il2CppRPM::il2cpp_string_readUTF8(uintptr_t strPtr, std::string& out)
   return true;
 }
 
-size_t Il2CppRPM::il2cpp_genericList_read(uintptr_t listPtr, std::vector<uintptr_t>* out, size_t maxCount)
+template <RPMBackend RPM>
+size_t BasicIl2CppRPM<RPM>::il2cpp_genericList_read(uintptr_t listPtr, std::vector<uintptr_t>* out, size_t maxCount)
 {
   il2cpp::System_Collections_Generic_List list;
-  if (!m_rpm.read<il2cpp::System_Collections_Generic_List>(listPtr, list))
+  if (!m_rpm.read(listPtr, list))
     return -1;
   if (out) {
     const size_t size = std::min<size_t>(list.size, maxCount);
@@ -284,4 +604,12 @@ size_t Il2CppRPM::il2cpp_genericList_read(uintptr_t listPtr, std::vector<uintptr
       m_rpm.read_raw(list.items + offsetof(il2cpp::Il2CppArray, items), out->data(), size * sizeof(uintptr_t));
   }
   return list.size;
-}
\ No newline at end of file
+}
+
+template class BasicIl2CppRPM<WinRPM>;
+template class BasicIl2CppRPM<SelfRPM>;
+template class BasicIl2CppRPM<SnapshotRPM>;
+template class BasicIl2CppRPM<ReplayRPM>;
+#if __linux__
+template class BasicIl2CppRPM<VmReadvRPM>;
+#endif
\ No newline at end of file
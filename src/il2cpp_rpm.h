@@ -1,13 +1,20 @@
 #pragma once
 
+#include <array>
 #include <filesystem>
 #include <span>
 #include <functional>
 #include <optional>
 
 #include "rpm.h"
+#include "rpm_backends.h"
+#include "rpm_stats.h"
+#include "snapshot.h"
+#include "rpm_trace.h"
 #include "mmap_view.h"
+#include "remote_view.h"
 #include "il2cpp_structs.h"
+#include "il2cpp_type_index.h"
 
 struct Il2CppId {
   std::string_view name;
@@ -19,39 +26,112 @@ struct Il2CppId {
   }
   inline constexpr bool operator==(const Il2CppId&) const = default;
   inline constexpr operator bool() const { return !name.empty(); };
+
+  /**
+   * See: Il2CppTypeIndex::hashId
+   */
+  inline constexpr uint64_t hash() const { return Il2CppTypeIndex::hashId(namespaze, name); }
+};
+
+/**
+ * The remote addresses of the name and namespace strings of a type inside the remote global-metadata.dat (see:
+ * BasicIl2CppRPM::meta_internId). The name and namespaze pointers of the type's classes point to exactly these.
+ */
+struct Il2CppInternedId {
+  uintptr_t name;
+  uintptr_t namespaze;
+};
+
+/**
+ * The beginning of an Il2CppClass, which is just enough to heuristically identify one.
+ */
+struct Il2CppClassHeader {
+  uintptr_t image;     // void*
+  uintptr_t gc_desc;   // void*
+  uintptr_t name;      // const char*
+  uintptr_t namespaze; // const char*
+  il2cpp::Il2CppType byval_arg;
+  il2cpp::Il2CppType this_arg;
+};
+
+enum class Il2CppOpenResult {
+  Ok,
+  NotFound,
+  NoPrivileges,
+  WinRPMError,
+  Il2CppError
 };
 
 /**
  * A simplpe class to read and write the memory of Il2Cpp Unity games remotely.
+ * The remote memory is accessed through the RPM backend (see: rpm_backends.h).
  */
-class Il2CppRPM
+template <RPMBackend RPM>
+class BasicIl2CppRPM
 {
 protected:
-  WinRPM m_rpm;
+  RPM m_rpm;
   uintptr_t m_gameAssemblyBase{};
   MemRange m_metadataRange{};
   MmapView m_metadataView;
+  RemoteView m_metadataRemote; // What m_metadataView wraps if the metadata is read lazily (see: meta_loadFromRemote)
+  Il2CppTypeIndex m_typeIndex;
+  uintptr_t m_typeInfoTable{}; // See: il2cpp_setTypeInfoTable
+  RegionIndex m_regions;
 
   bool m_verbose = false;
 
-public:
-  Il2CppRPM() = default;
-  Il2CppRPM(WinRPM::PathViewType processName) { this->open(processName); };
-  ~Il2CppRPM() { this->close(); }
-
-  enum class OpenResult {
-    Ok,
-    NotFound,
-    NoPrivileges,
-    WinRPMError,
-    Il2CppError
+  using MetaHeaderField = int32_t il2cpp::Il2CppGlobalMetadataHeader::*;
+
+  /**
+   * The metadata tables that are read locally (see: meta_getLocalByIdx and meta_ptrToLocal), as pairs of their
+   * [TABLE_NAME]Offset and [TABLE_NAME]Size fields in the metadata header. The metadata is mapped lazily, and only
+   * these tables are prefetched.
+   */
+  static constexpr std::pair<MetaHeaderField, MetaHeaderField> META_USED_TABLES[] = {
+    {&il2cpp::Il2CppGlobalMetadataHeader::stringOffset, &il2cpp::Il2CppGlobalMetadataHeader::stringSize},
+    {&il2cpp::Il2CppGlobalMetadataHeader::typeDefinitionsOffset,
+     &il2cpp::Il2CppGlobalMetadataHeader::typeDefinitionsSize},
   };
 
+public:
+  BasicIl2CppRPM() = default;
+  BasicIl2CppRPM(WinRPM::PathViewType processName) { this->open(processName); };
+  ~BasicIl2CppRPM() { this->close(); }
+
+  using OpenResult = Il2CppOpenResult;
+
   /**
    * Tries to open a remote il2cpp process.
    */
   OpenResult open(WinRPM::PathViewType processName);
+  OpenResult open(PID pid);
+
+protected:
+  /**
+   * Finds the il2cpp related stuff in the freshly opened process.
+   */
+  OpenResult attach();
+
+  // How many pages of the local global-metadata.dat are compared against the remote one (see: meta_verifySample)
+  static constexpr size_t META_VERIFY_SAMPLES = 16;
 
+  /**
+   * Checks whether the local global-metadata.dat matches the remote one, by comparing a fixed number of pages spread
+   * across them, so that it costs the same regardless of the size of the file. The pages that can't be read from the
+   * game are skipped, but at least one of them has to be compared.
+   */
+  bool meta_verifySample();
+
+  /**
+   * Reads the remote global-metadata.dat mapping, for when the file itself can't be opened (e.g. the game runs in a
+   * container, so the path in its memory map doesn't exist on our side).
+   * If possible, the mapping is viewed lazily (see: RemoteView), so that only the pages that are actually looked at
+   * are read. Otherwise it's read into a local arena as a whole.
+   */
+  bool meta_loadFromRemote();
+
+public:
   /**
    * Closes the handle to the process and resets the internal state.
    */
@@ -60,6 +140,20 @@ public:
   inline bool isOpen() const { return m_rpm.isOpen(); }
   explicit inline operator bool() const { return isOpen(); }
 
+  /**
+   * See: WinRPM::pollIsOpen
+   */
+  inline bool pollIsOpen() { return m_rpm.pollIsOpen(); }
+
+  /**
+   * See: WinRPM::getExitWaitHandle
+   */
+  inline WinRPM::ExitWaitHandle getExitWaitHandle() const
+    requires requires(const RPM& rpm) { rpm.getExitWaitHandle(); }
+  {
+    return m_rpm.getExitWaitHandle();
+  }
+
   inline bool isVerbose() const { return m_verbose; }
   inline void setVerbose(bool verbose) { m_verbose = verbose; }
 
@@ -70,6 +164,21 @@ public:
    */
   inline static bool isValidRemotePtr(uintptr_t remotePtr) { return (0 < remotePtr && remotePtr < (1ull << 48)); }
 
+  /**
+   * Rebuilds the index of the remote memory regions (see: isReadableRemotePtr).
+   */
+  inline bool refreshRegions() { return m_rpm.queryRegions(m_regions); }
+
+  /**
+   * Checks whether [remotePtr, remotePtr + size) is readable according to the region index, without any syscalls.
+   * Without an index (see: refreshRegions), it falls back to isValidRemotePtr. Note that the index is only a snapshot,
+   * so regions mapped since the last refresh will be rejected.
+   */
+  inline bool isReadableRemotePtr(uintptr_t remotePtr, size_t size) const
+  {
+    return BasicIl2CppRPM::isValidRemotePtr(remotePtr) && (m_regions.empty() || m_regions.isReadable(remotePtr, size));
+  }
+
   /**
    * Returns a reference to the metadata header.
    */
@@ -78,6 +187,17 @@ public:
     return m_metadataView.get<const il2cpp::Il2CppGlobalMetadataHeader>(0);
   }
 
+  /**
+   * Drops the local metadata from our resident set, e.g. once everything has been resolved from it. It stays
+   * accessible, its pages are just read back when needed (or fetched again from the game, if it's a lazy remote view).
+   */
+  inline void meta_dropResident()
+  {
+    m_metadataView.dropResident();
+    if (m_metadataRemote.isLazy())
+      m_metadataRemote.invalidate();
+  }
+
   /**
    * Maps a remote pointer inside the remote global-metadata.dat to a local pointer inside our own mapped version of
    * global-metadata.dat .
@@ -103,6 +223,24 @@ public:
     return m_metadataView.getPtr<T>(offset + index);
   }
 
+  /**
+   * Maps a remote Il2CppTypeDefinition pointer (e.g. the data of an IL2CPP_TYPE_CLASS Il2CppType) to its index in the
+   * metadata's typeDefinitions table.
+   */
+  std::optional<uint32_t> meta_getTypedefIdx(uintptr_t typedefPtr) const;
+
+  /**
+   * Finds the indices of the typedefs with the given name and namespace (see: Il2CppTypeIndex::find).
+   */
+  inline std::span<const uint32_t> meta_findTypedefs(const Il2CppId& id) const { return m_typeIndex.find(id.hash()); }
+
+  /**
+   * Looks up the remote addresses of the name and namespace strings of the given type, so that its classes can be
+   * matched by comparing their name and namespaze pointers, without reading any strings.
+   * Returns nothing if the type couldn't be found, or if its typedefs don't agree on the addresses.
+   */
+  std::optional<Il2CppInternedId> meta_internId(const Il2CppId& id) const;
+
   /**
    * Gets a string from the metadata's string table.
    */
@@ -114,12 +252,50 @@ public:
    */
   std::optional<std::string_view> meta_remoteStrToLocal(uintptr_t remotePtr, size_t maxLen = 512) const;
 
+  /**
+   * il2cpp's type info table is the array of Il2CppClass pointers indexed by typedef index, which il2cpp fills in as it
+   * initializes the classes. It's allocated when il2cpp starts up, and a pointer to it is kept in one of the globals of
+   * GameAssembly.dll. Once it's known, any class (whose typedef index is known, see: meta_findTypedefs) can be
+   * resolved with a single read.
+   *
+   * The table is validated by checking the classes of System.Object and System.String (which are initialized along
+   * with il2cpp) in it. It's kept until the process is closed.
+   */
+  bool il2cpp_setTypeInfoTable(uintptr_t table);
+  inline uintptr_t il2cpp_getTypeInfoTable() const { return m_typeInfoTable; }
+
+  /**
+   * Looks for the global pointing to the type info table in a local copy of one of the data sections of
+   * GameAssembly.dll (which starts at remoteAddr in the remote process), and sets the table if it finds it.
+   * The candidates are checked in batches, so it only costs a few syscalls per few hundred of them.
+   * Returns the remote address of the global, or 0 if it couldn't be found.
+   */
+  uintptr_t il2cpp_locateTypeInfoTable(const unsigned char* data, size_t dataSize, uintptr_t remoteAddr);
+
+  /**
+   * Retrieves the Il2CppClass of a typedef from the type info table (see: il2cpp_setTypeInfoTable).
+   * It returns 0 upon error, or if the class hasn't been initialized yet.
+   */
+  uintptr_t il2cpp_getClassByTypedefIdx(uint32_t typedefIdx);
+
+  /**
+   * Retrieves the Il2CppClass of a type by its name and namespace, through the type info table. The class found in the
+   * table is checked to actually have that name and namespace.
+   * It returns 0 upon error, or if the class hasn't been initialized yet.
+   */
+  uintptr_t il2cpp_findClass(const Il2CppId& id);
+
   /**
    * Heuristically checks whether the remote pointer points to an il2cpp class instance, and if so, then returns its
    * class name and namespace.
    */
   bool il2cpp_class_heuristicCheck(uintptr_t classPtr, Il2CppId& classId);
 
+  /**
+   * Same as above, but it works on an already read class header.
+   */
+  bool il2cpp_class_heuristicCheck(const Il2CppClassHeader& classHeader, Il2CppId& classId) const;
+
   /**
    * Retrieves the class instance of an Il2CppObject object.
    * It returns 0 upon error.
@@ -141,6 +317,22 @@ public:
    */
   bool il2cpp_class_hasNameAndNamespace(uintptr_t classPtr, const Il2CppId& id);
 
+  /**
+   * Same as above, but it works on an already read class header.
+   */
+  bool il2cpp_class_hasNameAndNamespace(const Il2CppClassHeader& classHeader, const Il2CppId& id) const;
+
+  /**
+   * Same as above, but it only compares pointers (see: meta_internId). It doubles as a heuristic check (see:
+   * il2cpp_class_heuristicCheck), since only actual classes point to the given strings.
+   */
+  inline bool il2cpp_class_hasNameAndNamespace(const Il2CppClassHeader& classHeader, const Il2CppInternedId& id) const
+  {
+    return classHeader.name == id.name && classHeader.namespaze == id.namespaze &&
+           classHeader.byval_arg.type == il2cpp::Il2CppTypeEnum::IL2CPP_TYPE_CLASS &&
+           classHeader.this_arg.type == il2cpp::Il2CppTypeEnum::IL2CPP_TYPE_CLASS;
+  }
+
   /**
    * Retrieves the name of an Il2CppTypeDefinition instance.
    */
@@ -180,4 +372,49 @@ public:
    * Upon error, it returns -1.
    */
   size_t il2cpp_genericList_read(uintptr_t listPtr, std::vector<uintptr_t>* out = nullptr, size_t maxCount = -1);
-};
\ No newline at end of file
+
+  /**
+   * Writes a field of an object, but only if the object is still an instance of the given class, and the field still
+   * holds the expected value (see: WinRPM::compare_and_write). This guards against writing into an object that has
+   * been destroyed (and whose memory has been reused) since it was read.
+   */
+  template <typename T>
+  CompareWriteResult il2cpp_obj_compareAndWriteField(
+    uintptr_t objPtr, uintptr_t classPtr, size_t fieldOffset, const T& expected, const T& desired
+  )
+    requires(std::is_trivially_copyable_v<T>)
+  {
+    std::array<CompareRequest, 2> checks;
+    const auto request = il2cpp_obj_prepareFieldWrite(objPtr, classPtr, fieldOffset, expected, desired, checks);
+    return m_rpm.compare_and_write(request.checks, request.remoteAddr, request.dataIn, request.dataSize);
+  }
+
+  /**
+   * Prepares a guarded field write (see: il2cpp_obj_compareAndWriteField), so that it can be carried out together with
+   * others (see: WinRPM::compare_and_write_batch). The checks are stored in the given array, and the request references
+   * them and the values, so they must all outlive it.
+   */
+  template <typename T>
+  static CompareWriteRequest il2cpp_obj_prepareFieldWrite(
+    uintptr_t objPtr, const uintptr_t& classPtr, size_t fieldOffset, const T& expected, const T& desired,
+    std::array<CompareRequest, 2>& checks
+  )
+    requires(std::is_trivially_copyable_v<T>)
+  {
+    checks = {{
+      {objPtr + offsetof(il2cpp::Il2CppObject, klass), &classPtr, sizeof(classPtr)},
+      {objPtr + fieldOffset, &expected, sizeof(T)},
+    }};
+    return {checks, objPtr + fieldOffset, &desired, sizeof(T)};
+  }
+};
+
+extern template class BasicIl2CppRPM<WinRPM>;
+extern template class BasicIl2CppRPM<SelfRPM>;
+extern template class BasicIl2CppRPM<SnapshotRPM>;
+extern template class BasicIl2CppRPM<ReplayRPM>;
+#if __linux__
+extern template class BasicIl2CppRPM<VmReadvRPM>;
+#endif
+
+using Il2CppRPM = BasicIl2CppRPM<WinRPM>;
\ No newline at end of file
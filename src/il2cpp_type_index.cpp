@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "il2cpp_type_index.h"
+#include "il2cpp_structs.h"
+
+bool Il2CppTypeIndex::build(const MmapView& metadata)
+{
+  this->clear();
+
+  if (!metadata.isOpen() || metadata.size() < sizeof(il2cpp::Il2CppGlobalMetadataHeader))
+    return false;
+  const auto& header = metadata.get<il2cpp::Il2CppGlobalMetadataHeader>(0);
+
+  const auto isInBounds = [&](int32_t offset, int32_t size) {
+    return offset >= 0 && size >= 0 && (uint64_t)offset + (uint64_t)size <= metadata.size();
+  };
+  if (!isInBounds(header.typeDefinitionsOffset, header.typeDefinitionsSize) ||
+      !isInBounds(header.stringOffset, header.stringSize))
+    return false;
+
+  const size_t count = header.typeDefinitionsSize / sizeof(il2cpp::Il2CppTypeDefinition);
+  if (!count || count > UINT32_MAX)
+    return false;
+  const auto typedefs = metadata.getPtr<il2cpp::Il2CppTypeDefinition>(header.typeDefinitionsOffset);
+
+  // Invalid indices yield empty strings, these types simply can't be found by their names
+  const char* strings = metadata.getPtr<char>(header.stringOffset);
+  const auto getString = [&](uint32_t index) -> std::string_view {
+    if (index >= (uint32_t)header.stringSize)
+      return {};
+    const char* str = strings + index;
+    const size_t maxLen = std::min<size_t>(header.stringSize - index, 512);
+    const auto nullpos = (const char*)::memchr(str, '\0', maxLen);
+    return {str, nullpos ? (size_t)(nullpos - str) : maxLen};
+  };
+
+  // Hash every typedef
+  m_hashes.resize(count);
+  m_sorted.resize(count);
+  for (uint32_t idx = 0; idx < count; ++idx) {
+    m_hashes[idx] = hashId(getString(typedefs[idx].namespaceIndex), getString(typedefs[idx].nameIndex));
+    m_sorted[idx] = idx;
+  }
+  std::sort(m_sorted.begin(), m_sorted.end(), [&](uint32_t lhs, uint32_t rhs) {
+    return m_hashes[lhs] < m_hashes[rhs] || (m_hashes[lhs] == m_hashes[rhs] && lhs < rhs);
+  });
+
+  // Make sure that the typedefs sharing a hash share their keys too
+  for (size_t first = 0, pos = 1; pos < count; ++pos) {
+    if (m_hashes[m_sorted[pos]] != m_hashes[m_sorted[first]]) {
+      first = pos;
+      continue;
+    }
+    const auto& lhs = typedefs[m_sorted[first]];
+    const auto& rhs = typedefs[m_sorted[pos]];
+    if (getString(lhs.namespaceIndex) != getString(rhs.namespaceIndex) ||
+        getString(lhs.nameIndex) != getString(rhs.nameIndex)) {
+      this->clear();
+      return false;
+    }
+  }
+
+  // Build the directory
+  const unsigned bits = std::bit_width(count);
+  m_shift = 64 - bits;
+  m_directory.assign(((size_t)1 << bits) + 1, 0);
+  size_t pos = 0;
+  for (size_t bucket = 0; bucket < m_directory.size() - 1; ++bucket) {
+    m_directory[bucket] = (uint32_t)pos;
+    while (pos < count && (m_hashes[m_sorted[pos]] >> m_shift) == bucket)
+      ++pos;
+  }
+  m_directory.back() = (uint32_t)count;
+  return true;
+}
+
+void Il2CppTypeIndex::clear()
+{
+  m_hashes.clear();
+  m_sorted.clear();
+  m_directory.clear();
+  m_shift = 64;
+}
+
+std::span<const uint32_t> Il2CppTypeIndex::find(uint64_t idHash) const
+{
+  if (this->empty())
+    return {};
+
+  const size_t bucket = idHash >> m_shift;
+  size_t pos = m_directory[bucket];
+  const size_t end = m_directory[bucket + 1];
+  while (pos < end && m_hashes[m_sorted[pos]] != idHash)
+    ++pos;
+  size_t last = pos;
+  while (last < end && m_hashes[m_sorted[last]] == idHash)
+    ++last;
+  return {m_sorted.data() + pos, last - pos};
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "mmap_view.h"
+
+/**
+ * An immutable index over the typeDefinitions table of global-metadata.dat, which maps the (namespace, name) of the
+ * types to their typedef indices, so that "find class Foo" and "is this typedef Foo" are O(1), without any string
+ * compares.
+ *
+ * The types are keyed by a 64 bit hash of their (namespace, name). The index is built in a single pass over the table,
+ * and refuses to build if two different keys share a hash, so a matching hash is as good as a matching key. The
+ * typedefs are sorted by their hashes, and a directory indexed by the top bits of the hash (with about as many buckets
+ * as types) points into them, so a lookup only has to look at about one entry.
+ */
+class Il2CppTypeIndex
+{
+protected:
+  std::vector<uint64_t> m_hashes;    // By typedef index
+  std::vector<uint32_t> m_sorted;    // The typedef indices, sorted by their hashes
+  std::vector<uint32_t> m_directory; // The first sorted entry of each bucket (and the end of the last one)
+  unsigned m_shift = 64;
+
+public:
+  /**
+   * Hashes the (namespace, name) of a type. It's constexpr, so the ids that are known up front can be hashed at compile
+   * time.
+   */
+  static constexpr uint64_t hashId(std::string_view namespaze, std::string_view name)
+  {
+    // FNV-1a, with 0xFF (which never occurs in UTF-8) separating the two parts
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c : namespaze)
+      hash = (hash ^ (uint8_t)c) * 0x100000001b3ull;
+    hash = (hash ^ 0xFF) * 0x100000001b3ull;
+    for (const char c : name)
+      hash = (hash ^ (uint8_t)c) * 0x100000001b3ull;
+
+    // The finalizer of MurmurHash3, so that the top bits (see: m_directory) are well distributed too
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  /**
+   * Builds the index from a mapped global-metadata.dat. Return indicates success.
+   */
+  bool build(const MmapView& metadata);
+
+  void clear();
+  inline bool empty() const { return m_hashes.empty(); }
+  explicit inline operator bool() const { return !empty(); }
+
+  /**
+   * Returns the number of indexed typedefs.
+   */
+  inline size_t size() const { return m_hashes.size(); }
+
+  /**
+   * Returns the indices of the typedefs with the given hash (see: hashId). Nested types, for example, often share
+   * their ids, so there might be more than one.
+   */
+  std::span<const uint32_t> find(uint64_t idHash) const;
+
+  /**
+   * Checks whether the typedef with the given index has the given hash (see: hashId).
+   */
+  inline bool has(uint32_t typedefIdx, uint64_t idHash) const
+  {
+    return typedefIdx < m_hashes.size() && m_hashes[typedefIdx] == idHash;
+  }
+};
\ No newline at end of file
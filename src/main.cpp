@@ -2,6 +2,7 @@
 #define _DISABLE_CONSTEXPR_MUTEX_CONSTRUCTOR 1
 
 #include <iostream>
+#include <fstream>
 #include <filesystem>
 #include <thread>
 #include <mutex>
@@ -10,15 +11,21 @@
 
 #if __linux__
 #include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #elif _WIN32
 #define _AMD64_
 #include <consoleapi.h>
 #include <ConsoleApi3.h>
 #include <winuser.h>
 #include <processthreadsapi.h>
+#include <handleapi.h>
+#include <synchapi.h>
 #endif
 
 #include "phasmem.h"
+#include "proc_events.h"
 
 static PhasMem g_phasMem;
 
@@ -36,7 +43,17 @@ static void printHelp(const char* argv0)
        "  -q, --quick-exit     don't wait for user input before exiting (default on Linux)\n"
        "  --dont-load-cache    bypass the cache and resolve the offsets directly from the game's memory\n"
        "  --dont-save-cache    don't save the offsets to cache\n"
-       "  --force [1/0]        force the isGhostSpawned flag to either true or false (for demonstration purposes)\n";
+       "  --force [1/0]        force the isGhostSpawned flag to either true or false (for demonstration purposes)\n"
+       "  --capture-snapshot [FILE]\n"
+       "                       save the memory touched by the first init and fix to a snapshot file\n"
+       "  --replay-snapshot [FILE]\n"
+       "                       run one init and fix on a snapshot file instead of the game, and time them\n"
+       "  --record-trace [FILE]\n"
+       "                       record every read and write of the first init and fix to a trace file\n"
+       "  --replay-trace [FILE]\n"
+       "                       run one init and fix on a trace file instead of the game, and time them\n"
+       "  --stats-json [FILE]  save the statistics of the memory accesses made by the first init and fix as JSON\n"
+       "                       (the statistics are only collected when built with PGVCF_RPM_STATS)\n";
   // clang-format on
 }
 
@@ -54,11 +71,124 @@ static void handleShutdown()
   }
 }
 
+// Wakes up the waiting main thread early, without shutting down
+static bool g_wakeUp = false;
+static void handleWakeUp()
+{
+  std::lock_guard shutdownLock{g_shutdownMtx};
+  g_wakeUp = true;
+  g_shutdownCv.notify_all();
+}
+
 template <typename T>
 inline static bool waitForShutdown(const T& delay)
 {
   std::unique_lock shutdownLock{g_shutdownMtx};
-  return (g_shutdownCv.wait_for(shutdownLock, delay, []() { return g_shutdown; }));
+  g_shutdownCv.wait_for(shutdownLock, delay, []() { return g_shutdown || g_wakeUp; });
+  g_wakeUp = false;
+  return g_shutdown;
+}
+
+/**
+ * Waits for the game to exit in the background, and wakes up the main thread as soon as it does, so that it doesn't
+ * have to wait for the next fix attempt to notice it. The thread works on its own copy of the exit wait handle.
+ */
+static std::jthread watchGameExit()
+{
+  constexpr int stopCheckDelayMs = 200;
+#if __linux__
+  const int pidfd = g_phasMem.getExitWaitHandle();
+  const int handle = pidfd < 0 ? -1 : ::fcntl(pidfd, F_DUPFD_CLOEXEC, 0);
+  if (handle < 0)
+    return {};
+  return std::jthread([handle](std::stop_token stop) {
+    pollfd pfd{handle, POLLIN, 0};
+    while (!stop.stop_requested()) {
+      if (::poll(&pfd, 1, stopCheckDelayMs) > 0) {
+        handleWakeUp();
+        break;
+      }
+    }
+    ::close(handle);
+  });
+#elif _WIN32
+  HANDLE handle{};
+  if (!::DuplicateHandle(
+        ::GetCurrentProcess(), g_phasMem.getExitWaitHandle(), ::GetCurrentProcess(), &handle, SYNCHRONIZE, false, 0
+      ))
+    return {};
+  return std::jthread([handle](std::stop_token stop) {
+    while (!stop.stop_requested()) {
+      if (::WaitForSingleObject(handle, stopCheckDelayMs) != WAIT_TIMEOUT) {
+        handleWakeUp();
+        break;
+      }
+    }
+    ::CloseHandle(handle);
+  });
+#endif
+}
+
+/**
+ * Reports the statistics of the memory accesses made so far: prints them in verbose mode, and saves them as JSON if a
+ * path is given (see: rpm_stats.h).
+ */
+static void reportRPMStats(bool verbose, const std::filesystem::path& jsonPath)
+{
+  if (verbose)
+    rpm_stats::dump(std::cout);
+  if (jsonPath.empty())
+    return;
+  std::ofstream os(jsonPath, std::ios_base::out | std::ios_base::trunc);
+  rpm_stats::exportJson(os);
+  if (!os)
+    std::cout << "[Error]: Couldn't save the statistics to '" << jsonPath.string() << "'.\n";
+}
+
+/**
+ * Runs one init and one fix on a recording of the game (see: --capture-snapshot, --record-trace), and reports how long
+ * they took.
+ */
+template <RPMBackend RPM>
+static int replayRecording(
+  const std::filesystem::path& recordingPath, bool verbose, bool shouldLoadCache,
+  PhasMem::WalkieTalkieFixState fixState, const std::filesystem::path& statsJsonPath
+)
+{
+  using clock = std::chrono::steady_clock;
+  using std::chrono::duration_cast, std::chrono::microseconds;
+
+  BasicPhasMem<RPM> phasMem;
+  phasMem.setVerbose(verbose);
+  phasMem.setShouldLoadCache(shouldLoadCache);
+  phasMem.setShouldSaveCache(false);
+  if (phasMem.openRecording(recordingPath) != Il2CppOpenResult::Ok) {
+    std::cout << "[Error]: Couldn't open recording '" << recordingPath.string() << "'.\n";
+    return 1;
+  }
+
+  const auto initStart = clock::now();
+  const bool inited = phasMem.init();
+  std::cout << "[Info]: Init " << (inited ? "succeeded" : "failed") << " in "
+            << duration_cast<microseconds>(clock::now() - initStart) << ".\n";
+  if (!inited)
+    return 1;
+
+  const auto fixStart = clock::now();
+  const bool fixed = phasMem.fixWalkieTalkies(fixState);
+  std::cout << "[Info]: Fix " << (fixed ? "succeeded" : "failed") << " in "
+            << duration_cast<microseconds>(clock::now() - fixStart) << ".\n";
+
+  if constexpr (std::same_as<RPM, ReplayRPM>) {
+    const auto& rpm = phasMem.getBackend();
+    const auto& stats = rpm.getReplayStats();
+    std::cout << "[Info]: Replayed " << stats.requests - stats.misses << "/" << rpm.getRecordCount()
+              << " recorded requests (" << stats.bytes << " bytes, " << stats.recordedSyscalls
+              << " syscalls when recorded), " << stats.misses << " requests had no match, " << stats.divergentWrites
+              << " writes diverged.\n";
+  }
+  reportRPMStats(verbose, statsJsonPath);
+  return fixed ? 0 : 1;
 }
 
 static bool g_shouldWaitBeforeExit = false;
@@ -98,6 +228,11 @@ int main(int argc, const char* argv[])
   bool sholdLoadCache = true;
   bool sholdSaveCache = true;
   PhasMem::WalkieTalkieFixState fixState = PhasMem::WalkieTalkieFixState::Auto;
+  std::filesystem::path snapshotCapturePath;
+  std::filesystem::path snapshotReplayPath;
+  std::filesystem::path traceRecordPath;
+  std::filesystem::path traceReplayPath;
+  std::filesystem::path statsJsonPath;
 
   for (int i = 1; i < argc; ++i) {
     const std::string_view arg{argv[i]};
@@ -134,6 +269,27 @@ int main(int argc, const char* argv[])
         printHelp(argv[0]);
         return 1;
       }
+    } else if (arg == "--capture-snapshot" || arg == "--replay-snapshot") {
+      if (i + 1 >= argc) {
+        std::cerr << "Not enough arguments for " << arg << "\n";
+        printHelp(argv[0]);
+        return 1;
+      }
+      (arg == "--capture-snapshot" ? snapshotCapturePath : snapshotReplayPath) = argv[++i];
+    } else if (arg == "--record-trace" || arg == "--replay-trace") {
+      if (i + 1 >= argc) {
+        std::cerr << "Not enough arguments for " << arg << "\n";
+        printHelp(argv[0]);
+        return 1;
+      }
+      (arg == "--record-trace" ? traceRecordPath : traceReplayPath) = argv[++i];
+    } else if (arg == "--stats-json") {
+      if (i + 1 >= argc) {
+        std::cerr << "Not enough arguments for --stats-json\n";
+        printHelp(argv[0]);
+        return 1;
+      }
+      statsJsonPath = argv[++i];
     } else {
       std::cerr << "Invalid argument '" << arg << "'\n";
       printHelp(argv[0]);
@@ -145,6 +301,15 @@ int main(int argc, const char* argv[])
   g_phasMem.setShouldLoadCache(sholdLoadCache);
   g_phasMem.setShouldSaveCache(sholdSaveCache);
 
+  // Replaying a recording doesn't need the game
+  if (!snapshotReplayPath.empty() || !traceReplayPath.empty()) {
+    const int ret =
+      !snapshotReplayPath.empty()
+        ? replayRecording<SnapshotRPM>(snapshotReplayPath, verbose, sholdLoadCache, fixState, statsJsonPath)
+        : replayRecording<ReplayRPM>(traceReplayPath, verbose, sholdLoadCache, fixState, statsJsonPath);
+    return (waitBeforeExit(), ret);
+  }
+
   // --------------------
   // - Main
   // --------------------
@@ -154,6 +319,9 @@ int main(int argc, const char* argv[])
   constexpr std::chrono::milliseconds initRetryDelay{5000};
   constexpr std::chrono::milliseconds fixDelay{5000};
   constexpr auto maxInitAttempts = 30;
+  constexpr std::chrono::milliseconds execWatchTimeout{1000};
+  constexpr std::chrono::milliseconds earlyOpenRetryDelay{1000};
+  constexpr auto maxEarlyOpenAttempts = 60;
 
   // Set CTRL-C handler
 #if __linux__
@@ -166,8 +334,36 @@ int main(int argc, const char* argv[])
   {
     auto openStatus = g_phasMem.open();
     if (!singleshot) {
+      // If we can, get notified as soon as the game starts, instead of periodically scanning every process
+      ProcExecWatcher execWatcher;
+      if (openStatus == Il2CppRPM::OpenResult::NotFound && execWatcher.open()) {
+        // The game might have been started before we've subscribed
+        openStatus = g_phasMem.open();
+        if (openStatus == Il2CppRPM::OpenResult::NotFound)
+          std::cout << "[Info]: Waiting for Phasmophobia to start.\n";
+      }
+
       // Wait for Phasmophobia
       while (openStatus == Il2CppRPM::OpenResult::NotFound) {
+        if (execWatcher.isOpen()) {
+          // Wake up every now and then, so that we can exit on CTRL-C
+          const PID pid = execWatcher.waitForProcess(PhasMem::PHASMO_EXE_NAME, execWatchTimeout);
+          if (waitForShutdown(std::chrono::milliseconds{0}))
+            return (waitBeforeExit(), 0);
+          if (!pid)
+            continue;
+
+          // The game has just started, so it most likely hasn't loaded GameAssembly.dll and the metadata yet
+          openStatus = g_phasMem.open(pid);
+          for (int attempt = 1; openStatus == Il2CppRPM::OpenResult::Il2CppError && attempt < maxEarlyOpenAttempts;
+               ++attempt) {
+            if (waitForShutdown(earlyOpenRetryDelay))
+              return (waitBeforeExit(), 0);
+            openStatus = g_phasMem.open(pid);
+          }
+          continue;
+        }
+
         std::cout << "[Info]: Waiting for Phasmophobia. Retrying in " << openRetryDelay << "\n";
         if (waitForShutdown(openRetryDelay))
           return (waitBeforeExit(), 0);
@@ -190,6 +386,17 @@ int main(int argc, const char* argv[])
     }
   }
 
+  // Get notified as soon as the game exits
+  const auto gameExitWatcher = watchGameExit();
+
+  // Record what the first init and fix touch
+  if (!snapshotCapturePath.empty())
+    g_phasMem.startSnapshotCapture();
+  if (!traceRecordPath.empty() && !g_phasMem.startTrace(traceRecordPath)) {
+    std::cout << "[Error]: Couldn't start recording to '" << traceRecordPath.string() << "'.\n";
+    traceRecordPath.clear();
+  }
+
   // Init phasmo
   {
     g_phasMem.init();
@@ -207,6 +414,12 @@ int main(int argc, const char* argv[])
       if (waitForShutdown(initRetryDelay))
         return (waitBeforeExit(), 0);
 
+      // Don't bother if the game has been closed
+      if (!g_phasMem.pollIsOpen()) {
+        std::cout << "[Info]: Phasmophobia was closed. Shutting down...\n";
+        return (waitBeforeExit(), 1);
+      }
+
       // Try again
       g_phasMem.init();
     }
@@ -214,9 +427,32 @@ int main(int argc, const char* argv[])
 
   // Fix loop
   {
+    bool statsReported = false;
     const auto pulseFix = [&]() {
       if (!g_phasMem.fixWalkieTalkies(fixState) && g_phasMem.isOpen())
         std::cout << "[Error]: Encountered an error while trying to apply the fix.\n";
+
+      // Save the snapshot after the first fix
+      if (!snapshotCapturePath.empty() && g_phasMem.isOpen()) {
+        if (g_phasMem.captureSnapshot(snapshotCapturePath))
+          std::cout << "[Info]: Saved snapshot to '" << snapshotCapturePath.string() << "'.\n";
+        else
+          std::cout << "[Error]: Couldn't save snapshot to '" << snapshotCapturePath.string() << "'.\n";
+        snapshotCapturePath.clear();
+      }
+
+      // Finish the trace after the first fix
+      if (!traceRecordPath.empty()) {
+        g_phasMem.stopTrace();
+        std::cout << "[Info]: Saved trace to '" << traceRecordPath.string() << "'.\n";
+        traceRecordPath.clear();
+      }
+
+      // Report the statistics of the first init and fix
+      if (!statsReported) {
+        reportRPMStats(verbose, statsJsonPath);
+        statsReported = true;
+      }
     };
 
     if (singleshot) {
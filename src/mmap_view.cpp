@@ -4,18 +4,22 @@
 #include <sys/mman.h>
 #elif _WIN32
 #define _AMD64_
+#include <sdkddkver.h>
 #include <fileapi.h>
 #include <handleapi.h>
 #include <memoryapi.h>
+#include <processthreadsapi.h>
 #endif
 
+#include <algorithm>
+
 #include "mmap_view.h"
 
 #if __linux__
 
 static const auto PAGESIZE = sysconf(_SC_PAGESIZE);
 
-bool MmapView::open(const std::filesystem::path& filePath)
+bool MmapView::open(const std::filesystem::path& filePath, MapMode mode)
 {
   this->close();
 
@@ -35,11 +39,16 @@ bool MmapView::open(const std::filesystem::path& filePath)
   const size_t mappedSize = (fileSize + PAGESIZE - 1) & ~(PAGESIZE - 1u);
 
   // Perform the mmap, and close the file handle immediately after (as per the docs, we can do this).
-  const void* data = ::mmap(nullptr, mappedSize, PROT_READ, MAP_POPULATE | MAP_SHARED, fd, 0);
+  const int flags = (mode == MapMode::Populate ? MAP_POPULATE : 0) | MAP_SHARED;
+  const void* data = ::mmap(nullptr, mappedSize, PROT_READ, flags, fd, 0);
   ::close(fd);
   if (data == MAP_FAILED)
     return false;
 
+  // Lazy views are accessed sparsely, so a fault shouldn't read ahead the pages around it
+  if (mode == MapMode::Lazy)
+    ::madvise((void*)data, mappedSize, MADV_RANDOM);
+
   // Save the state
   m_state.data = data;
   m_state.size = fileSize;
@@ -53,14 +62,48 @@ void MmapView::close()
   if (!this->isOpen())
     return;
 
-  ::munmap((void*)m_state.data, m_state.mappedSize);
+  if (!m_state.external)
+    ::munmap((void*)m_state.data, m_state.mappedSize);
   m_state = {};
 }
 
+unsigned char* MmapView::allocate(size_t size)
+{
+  this->close();
+
+  const size_t mappedSize = (size + PAGESIZE - 1) & ~(PAGESIZE - 1u);
+  void* data = ::mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED)
+    return nullptr;
+
+  m_state.data = data;
+  m_state.size = size;
+  m_state.mappedSize = mappedSize;
+  m_state.anonymous = true;
+  return (unsigned char*)data;
+}
+
+void MmapView::willNeed(size_t offset, size_t size) const
+{
+  const size_t start = offset & ~(PAGESIZE - 1u);
+  const size_t end = std::min(offset + size, m_state.mappedSize);
+  if (!this->isOpen() || m_state.external || start >= end)
+    return;
+  ::madvise((unsigned char*)m_state.data + start, end - start, MADV_WILLNEED);
+}
+
+void MmapView::dropResident() const
+{
+  // The mapping is read-only and shared, so nothing is lost by dropping its pages
+  if (this->isOpen() && !m_state.anonymous && !m_state.external)
+    ::madvise((void*)m_state.data, m_state.mappedSize, MADV_DONTNEED);
+}
+
 #elif _WIN32
 
-bool MmapView::open(const std::filesystem::path& filePath)
+bool MmapView::open(const std::filesystem::path& filePath, MapMode mode)
 {
+  // Views are always mapped lazily on Windows, and that's what MapMode::Populate falls back to
   this->close();
 
   // Open the file
@@ -115,11 +158,65 @@ void MmapView::close()
   if (!this->isOpen())
     return;
 
-  ::UnmapViewOfFile(m_state.data);
-  ::CloseHandle(m_state.handleMapping);
-  ::CloseHandle(m_state.handleFile);
+  if (m_state.external) {
+    // Not ours to release
+  } else if (m_state.anonymous) {
+    ::VirtualFree((void*)m_state.data, 0, MEM_RELEASE);
+  } else {
+    ::UnmapViewOfFile(m_state.data);
+    ::CloseHandle(m_state.handleMapping);
+    ::CloseHandle(m_state.handleFile);
+  }
 
   m_state = {};
 }
 
+unsigned char* MmapView::allocate(size_t size)
+{
+  this->close();
+
+  void* data = ::VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  if (!data)
+    return nullptr;
+
+  // Get the actual size of the allocated memory region
+  MEMORY_BASIC_INFORMATION mbi;
+  if (!::VirtualQuery(data, &mbi, sizeof(mbi))) {
+    ::VirtualFree(data, 0, MEM_RELEASE);
+    return nullptr;
+  }
+
+  m_state.data = data;
+  m_state.size = size;
+  m_state.mappedSize = (size_t)mbi.RegionSize;
+  m_state.anonymous = true;
+  return (unsigned char*)data;
+}
+
+void MmapView::willNeed(size_t offset, size_t size) const
+{
+  const size_t end = std::min(offset + size, m_state.mappedSize);
+  if (!this->isOpen() || m_state.external || offset >= end)
+    return;
+  WIN32_MEMORY_RANGE_ENTRY range{(unsigned char*)m_state.data + offset, end - offset};
+  ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+}
+
+void MmapView::dropResident() const
+{
+  // Unlocking pages that aren't locked removes them from the working set (and fails with ERROR_NOT_LOCKED)
+  if (this->isOpen() && !m_state.anonymous && !m_state.external)
+    ::VirtualUnlock((void*)m_state.data, m_state.mappedSize);
+}
+
 #endif
+
+void MmapView::wrap(const void* data, size_t size)
+{
+  this->close();
+
+  m_state.data = data;
+  m_state.size = size;
+  m_state.mappedSize = size;
+  m_state.external = true;
+}
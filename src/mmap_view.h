@@ -21,6 +21,8 @@ protected:
     const void* data = nullptr; // Pointer to the mapped data in memory
     size_t size = 0;            // The (requested) size of the mapped data
     size_t mappedSize = 0;      // The (actual) size of the mapped data (basically m_size rounded up to a page boundary)
+    bool anonymous = false;     // Whether it's an arena (see: allocate), rather than a mapped file
+    bool external = false;      // Whether it wraps memory owned by someone else (see: wrap)
 
 #if __linux__
 #elif _WIN32
@@ -30,8 +32,13 @@ protected:
   } m_state;
 
 public:
+  enum class MapMode {
+    Populate, // Read the whole file into memory up front
+    Lazy      // Only read the pages when they are first accessed (or prefetched, see: willNeed)
+  };
+
   MmapView() noexcept = default;
-  MmapView(const std::filesystem::path& filePath) { this->open(filePath); };
+  MmapView(const std::filesystem::path& filePath, MapMode mode = MapMode::Populate) { this->open(filePath, mode); };
   ~MmapView() { this->close(); }
 
   MmapView(const MmapView&) = delete;
@@ -49,15 +56,41 @@ public:
    * Tries to map a file into memory for reading.
    * Return indicates success. Previously mapped files will be automatically closed.
    */
-  bool open(const std::filesystem::path& filePath);
+  bool open(const std::filesystem::path& filePath, MapMode mode = MapMode::Populate);
+
+  /**
+   * Allocates a zeroed arena of the given size instead of mapping a file, so that data that was obtained some other
+   * way (e.g. read from a remote process) can be accessed through the same interface.
+   * Returns a writable pointer to the arena, or a null pointer upon error. Previously mapped files will be
+   * automatically closed.
+   */
+  unsigned char* allocate(size_t size);
+
+  /**
+   * Wraps memory owned by someone else (e.g. a RemoteView) without copying it, so that it can be accessed through the
+   * same interface. The memory has to outlive the view. Previously mapped files will be automatically closed.
+   */
+  void wrap(const void* data, size_t size);
 
   /**
-   * Unmaps the file from memory.
+   * Unmaps the file (or frees the arena) from memory.
    */
   void close();
   inline constexpr bool isOpen() const { return m_state.data != nullptr; }
   explicit inline constexpr operator bool() const { return isOpen(); }
 
+  /**
+   * Hints that [offset, offset + size) is going to be accessed soon, so that its pages can be read in the background.
+   */
+  void willNeed(size_t offset, size_t size) const;
+
+  /**
+   * Drops every page of the view from our resident set. The view stays valid: the pages are read back (most likely from
+   * the OS' file cache) if they are accessed again.
+   * Arenas have nothing to read their pages back from, so they are left alone, and so is wrapped memory.
+   */
+  void dropResident() const;
+
   inline const unsigned char* data() const { return static_cast<const unsigned char*>(m_state.data); }
   inline const unsigned char& operator[](size_t offset) const { return *(this->data() + offset); }
 
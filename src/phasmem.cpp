@@ -23,7 +23,8 @@
 #define LOG_VERBF(...) if (m_verbose) std::cerr << std::format(__VA_ARGS__)
 // clang-format on
 
-bool PhasMem::loadCache()
+template <RPMBackend RPM>
+bool BasicPhasMem<RPM>::loadCache()
 {
   // Try to open the cache file
   std::ifstream is(m_cachePath, std::ios_base::in | std::ios_base::binary);
@@ -36,6 +37,7 @@ bool PhasMem::loadCache()
   m_cacheData = {};
   if (!(is.read((char*)&m_cacheData, sizeof(m_cacheData)))) {
     LOG_CERRF("[Error]: Couldn't read cache file '{:s}'.\n", m_cachePath.string());
+    m_cacheData = {}; // It might have been read partially (e.g. it was saved by an older version)
     return false;
   }
 
@@ -43,7 +45,8 @@ bool PhasMem::loadCache()
   return true;
 }
 
-bool PhasMem::saveCache()
+template <RPMBackend RPM>
+bool BasicPhasMem<RPM>::saveCache()
 {
   // Try to open the cache file
   std::ofstream os(m_cachePath, std::ios_base::out | std::ios_base::binary);
@@ -62,26 +65,68 @@ bool PhasMem::saveCache()
   return true;
 }
 
-Il2CppRPM::OpenResult PhasMem::open()
+template <RPMBackend RPM>
+Il2CppOpenResult BasicPhasMem<RPM>::open()
 {
-  return Il2CppRPM::open(PHASMO_EXE_NAME);
+  if (const PID pid = WinRPM::getPIDByFilename(PHASMO_EXE_NAME, m_processDiscovery))
+    return this->open(pid);
+  m_rpm.close();
+  return Il2CppOpenResult::NotFound;
 }
 
-void PhasMem::close()
+template <RPMBackend RPM>
+Il2CppOpenResult BasicPhasMem<RPM>::open(PID pid)
+{
+  if constexpr (HAS_PAGE_CACHE)
+    m_rpm.enablePageCache(PAGE_CACHE_MAX_PAGES);
+  return Il2CppRPM::open(pid);
+}
+
+template <RPMBackend RPM>
+Il2CppOpenResult BasicPhasMem<RPM>::openRecording(const std::filesystem::path& recordingPath)
+  requires std::same_as<RPM, SnapshotRPM> || std::same_as<RPM, ReplayRPM>
+{
+  return Il2CppRPM::open(recordingPath.native());
+}
+
+template <RPMBackend RPM>
+void BasicPhasMem<RPM>::startSnapshotCapture()
+  requires std::same_as<RPM, WinRPM>
+{
+  m_rpm.trackTouchedPages(true);
+}
+
+template <RPMBackend RPM>
+bool BasicPhasMem<RPM>::captureSnapshot(const std::filesystem::path& snapshotPath)
+  requires std::same_as<RPM, WinRPM>
+{
+  // The metadata is only ever read locally, so it has to be embedded
+  //  If it's a lazy view of the game's memory, then its pages have to be fetched before they are written out.
+  m_metadataRemote.populate();
+  const snapshot::EmbeddedFile files[] = {
+    {WINRPM_PATH("global-metadata.dat"), {m_metadataView.data(), m_metadataView.size()}}
+  };
+  return snapshot::capture(snapshotPath, m_rpm, files);
+}
+
+template <RPMBackend RPM>
+void BasicPhasMem<RPM>::close()
 {
   Il2CppRPM::close();
   m_inited = false;
   m_cacheData = {};
   m_dynData = {};
+  m_dataScan = {};
 }
 
 struct PEVirtualSection {
   uintptr_t offset{}; // VirtualAddress
-  uintptr_t size{};   // SizeOfRawData
+  uintptr_t size{};   // max(VirtualSize, SizeOfRawData)
 };
 
 /**
- * Tries to find the VirtualAddress and SizeOfRawData fields of a PE section based on the section's name.
+ * Tries to find the VirtualAddress and the size of a PE section based on the section's name.
+ * The size includes the zero-initialized tail of the section (i.e. where MSVC puts .bss), which isn't in the file.
  * Upon failure, the offset will be set to 0.
  */
 static PEVirtualSection findPEVirtualSection(void* peFileBase, std::string_view sectionName)
@@ -168,13 +213,14 @@ static PEVirtualSection findPEVirtualSection(void* peFileBase, std::string_view
                                       peHeader->FileHeader.SizeOfOptionalHeader);
   for (int i = 0; i < peHeader->FileHeader.NumberOfSections; ++i, ++sectionHeader) {
     if (::memcmp(sectionHeader->Name, sectionName.data(), sectionName.size()) == 0) {
-      return {sectionHeader->VirtualAddress, sectionHeader->SizeOfRawData};
+      return {sectionHeader->VirtualAddress, std::max(sectionHeader->Misc.VirtualSize, sectionHeader->SizeOfRawData)};
     }
   }
   return {};
 }
 
-bool PhasMem::init()
+template <RPMBackend RPM>
+bool BasicPhasMem<RPM>::init()
 {
   // Reinit
   m_inited = false;
@@ -185,6 +231,16 @@ bool PhasMem::init()
     return false;
   }
 
+  // Everything read from here on should reflect the current state of the game
+  if constexpr (HAS_PAGE_CACHE) {
+    m_rpm.beginEpoch();
+    m_rpm.resetPageCacheStats();
+  }
+
+  // Lets the .data scan throw away the candidates that point to unmapped memory without having to read them
+  if (!this->refreshRegions())
+    LOG_VERB("[Warning]: Couldn't query the memory regions of the game.\n");
+
   // -----------------------------
   // - Network and PlayerSpot class file offsets
   // -----------------------------
@@ -202,15 +258,39 @@ bool PhasMem::init()
     }
   };
 
+  // Once il2cpp's type info table is known, the classes can be looked up directly (if they've been initialized)
+  const auto findClassesInTypeInfoTable = [&]() {
+    if (!this->il2cpp_getTypeInfoTable())
+      return;
+    if (!m_dynData.pcls_Network)
+      m_dynData.pcls_Network = this->il2cpp_findClass({"Network", ""});
+    if (!m_dynData.pcls_PlayerSpot)
+      m_dynData.pcls_PlayerSpot = this->il2cpp_findClass({"PlayerSpot", ""});
+  };
+
   // Try the cache
   m_cacheData = {};
+  m_dynData.pcls_Network = 0;
+  m_dynData.pcls_PlayerSpot = 0;
   if (m_shouldLoadCache && this->loadCache()) {
     checkCachedClass("Network", m_cacheData.cls_Network, m_dynData.pcls_Network);
     checkCachedClass("PlayerSpot", m_cacheData.cls_PlayerSpot, m_dynData.pcls_PlayerSpot);
+
+    uintptr_t typeInfoTable;
+    if (m_cacheData.typeInfoTable) {
+      if (m_rpm.read(m_gameAssemblyBase, typeInfoTable, m_cacheData.typeInfoTable) &&
+          this->il2cpp_setTypeInfoTable(typeInfoTable)) {
+        LOG_VERB("[Debug]: Found the type info table in the cache.\n");
+        findClassesInTypeInfoTable();
+      } else {
+        LOG_VERB("[Debug]: The cached type info table offset was invalid.\n");
+        m_cacheData.typeInfoTable = 0;
+      }
+    }
   }
 
   // Did we manage to find everything in the cache?
-  const bool wasCacheValid = m_cacheData.cls_Network && m_cacheData.cls_PlayerSpot;
+  const bool wasCacheValid = m_dynData.pcls_Network && m_dynData.pcls_PlayerSpot;
   if (wasCacheValid) {
     // If the cache is valid, that means we've already resolved the class instances too.
     LOG_CERR("[Info]: Cache was fully valid, skipping .data section scanning.\n");
@@ -218,6 +298,7 @@ bool PhasMem::init()
     if (m_shouldLoadCache)
       LOG_CERR("[Info]: Couldn't find every offset in the cache.\n");
     LOG_CERR("[Info]: Scanning .data section.\n");
+    const rpm_stats::ScopedTag statsTag(rpm_stats::TAG_DATA_SCAN);
 
     // Read and parse the PE header of GameAssembly.dll from the memory
     std::array<char, 0x1000> headerBuffer;
@@ -233,33 +314,183 @@ bool PhasMem::init()
       return false;
     }
 
-    {
-      // Read the entire .data section (~6-7 MB)
-      auto dataSegBuffer = std::make_unique<unsigned char[]>(dataSec.size);
-      if (!m_rpm.read_raw(m_gameAssemblyBase + dataSec.offset, dataSegBuffer.get(), dataSec.size)) {
+    // Read the .data section (~6-7 MB)
+    //  On the first attempt, the whole section is read in parallel chunks. The unreadable chunks (if any) are zeroed
+    //  out, so the scan simply doesn't find any candidates in them. The same goes for the chunks that the game has
+    //  never touched (the class instance pointers we are looking for are written at runtime, so they can't be there),
+    //  which aren't even read, so that they don't get faulted in.
+    //  If a previous attempt has failed (e.g. the game is still loading), and the soft-dirty bits of the game were
+    //  cleared before it read the section, then only the pages that have been written since are re-read and rescanned.
+    const uintptr_t dataSecAddr = m_gameAssemblyBase + dataSec.offset;
+    PageResidency residency;
+    const bool hasResidency = m_rpm.queryPageResidency(dataSecAddr, dataSec.size, residency);
+    const bool incremental = hasResidency && m_dataScan.softDirtyTracked && m_dataScan.addr == dataSecAddr &&
+                             m_dataScan.size == dataSec.size;
+
+    // Track the pages written from here on, for the next attempt
+    const bool softDirtyTracked = hasResidency && m_rpm.clearSoftDirty();
+
+    std::vector<std::pair<size_t, size_t>> scanRanges; // [begin, end) offsets into the section, in ascending order
+    if (!incremental) {
+      m_dataScan = {dataSecAddr, dataSec.size, std::make_unique_for_overwrite<unsigned char[]>(dataSec.size)};
+      const auto dataRead =
+        m_rpm.read_large(dataSecAddr, m_dataScan.buffer.get(), dataSec.size, hasResidency ? &residency : nullptr);
+      if (!dataRead.numOk) {
         LOG_VERBF("[Error]: Couldn't read .data section.\n");
+        m_dataScan = {};
         return false;
       }
+      if (dataRead.numFailed())
+        LOG_VERBF(
+          "[Warning]: {}/{} chunks of the .data section couldn't be read.\n", dataRead.numFailed(),
+          dataRead.chunkCount()
+        );
+      if (dataRead.numSkipped)
+        LOG_VERBF(
+          "[Debug]: Skipped {}/{} untouched chunks of the .data section.\n", dataRead.numSkipped, dataRead.chunkCount()
+        );
+      scanRanges.push_back({0, dataSec.size});
+    } else {
+      // Re-read the runs of written pages
+      std::vector<WinRPM::ReadRequest> requests;
+      size_t numDirtyPages = 0;
+      const auto isDirty = [&](size_t page) { return residency.pages[page] & PageResidency::PAGE_SOFT_DIRTY; };
+      for (size_t page = 0; page < residency.pages.size();) {
+        if (!isDirty(page)) {
+          ++page;
+          continue;
+        }
+        size_t endPage = page + 1;
+        while (endPage < residency.pages.size() && isDirty(endPage))
+          ++endPage;
+        numDirtyPages += endPage - page;
+
+        const uintptr_t begin = std::max(residency.firstPage + page * PageResidency::PAGE_SIZE, dataSecAddr);
+        const uintptr_t end =
+          std::min(residency.firstPage + endPage * PageResidency::PAGE_SIZE, dataSecAddr + dataSec.size);
+        scanRanges.push_back({begin - dataSecAddr, end - dataSecAddr});
+        requests.push_back({begin, &m_dataScan.buffer[begin - dataSecAddr], end - begin});
+        page = endPage;
+      }
+      m_rpm.read_batch(requests);
+      for (const auto& request : requests) {
+        if (!request.ok)
+          ::memset(request.dataOut, 0, request.dataSize);
+      }
+      LOG_VERBF(
+        "[Debug]: Rescanning {}/{} changed pages of the .data section.\n", numDirtyPages, residency.pages.size()
+      );
+
+      // Whatever has been found on the changed pages has to be found again
+      const auto forgetIfChanged = [&](uintptr_t& clsOffset) {
+        for (const auto& [begin, end] : scanRanges) {
+          if (clsOffset >= dataSec.offset + begin && clsOffset < dataSec.offset + end)
+            clsOffset = 0;
+        }
+      };
+      forgetIfChanged(m_dataScan.cls_Network);
+      forgetIfChanged(m_dataScan.cls_PlayerSpot);
+      forgetIfChanged(m_dataScan.typeInfoTable);
+    }
+    m_dataScan.softDirtyTracked = softDirtyTracked;
+    const unsigned char* dataSegBuffer = m_dataScan.buffer.get();
+
+    // Start from what the previous attempts have found, unless the cache has already resolved it
+    const auto restoreClass = [&](uintptr_t& cacheField, uintptr_t scanField, uintptr_t& dynField) {
+      if (cacheField || !scanField)
+        return;
+      cacheField = scanField;
+      if (!dynField)
+        dynField = *(const uintptr_t*)&dataSegBuffer[scanField - dataSec.offset];
+    };
+    restoreClass(m_cacheData.cls_Network, m_dataScan.cls_Network, m_dynData.pcls_Network);
+    restoreClass(m_cacheData.cls_PlayerSpot, m_dataScan.cls_PlayerSpot, m_dynData.pcls_PlayerSpot);
+    if (!m_cacheData.typeInfoTable)
+      m_cacheData.typeInfoTable = m_dataScan.typeInfoTable;
+
+    // Look for the type info table first, since if it's found, then the classes can simply be looked up in it
+    //  Its pointer is zero-initialized, so it's usually in the .bss part of the section.
+    for (size_t idx = 0; idx < scanRanges.size() && !m_cacheData.typeInfoTable; ++idx) {
+      const auto [begin, end] = scanRanges[idx];
+      const uintptr_t slot = this->il2cpp_locateTypeInfoTable(&dataSegBuffer[begin], end - begin, dataSecAddr + begin);
+      if (slot) {
+        m_cacheData.typeInfoTable = slot - m_gameAssemblyBase;
+        LOG_VERBF("[Debug]: Found the type info table at offset {:#x}.\n", m_cacheData.typeInfoTable);
+      }
+    }
+    findClassesInTypeInfoTable();
+
+    // Scan the .data section
+    //  The candidates are verified in windows: the class headers of a whole window are read asynchronously (so the
+    //  reads are carried out in parallel, at the cost of a few syscalls), and then checked in order.
+    struct Candidate {
+      uintptr_t offset{};
+      Il2CppClassHeader header{};
+      WinRPM::AsyncRequest request{};
+    };
+    std::vector<Candidate> window;
+    window.reserve(WinRPM::ASYNC_QUEUE_DEPTH);
+
+    // The candidates are matched by the addresses of their name strings whenever possible (see: meta_internId), so
+    // that the vast majority of them are rejected without reading any strings
+    const auto networkId = this->meta_internId({"Network", ""});
+    const auto playerSpotId = this->meta_internId({"PlayerSpot", ""});
+    const auto isClass = [&](const Il2CppClassHeader& header, const std::optional<Il2CppInternedId>& interned,
+                             const Il2CppId& id) {
+      if (interned)
+        return this->il2cpp_class_hasNameAndNamespace(header, *interned);
+      Il2CppId classId;
+      return this->il2cpp_class_heuristicCheck(header, classId) && classId == id;
+    };
+
+    size_t rangeIdx = 0;
+    uintptr_t offset = 0;
+    while (rangeIdx < scanRanges.size() && (!m_dynData.pcls_Network || !m_dynData.pcls_PlayerSpot)) {
+      // Collect the candidates of the next window
+      window.clear();
+      while (rangeIdx < scanRanges.size() && window.size() < WinRPM::ASYNC_QUEUE_DEPTH) {
+        const auto [begin, end] = scanRanges[rangeIdx];
+        offset = std::max<uintptr_t>(offset, (begin + 7) & ~(uintptr_t)7);
+        if (offset + sizeof(uintptr_t) > end) {
+          ++rangeIdx;
+          continue;
+        }
+        if (this->isReadableRemotePtr(*(const uintptr_t*)&dataSegBuffer[offset], sizeof(Il2CppClassHeader)))
+          window.push_back({offset});
+        offset += 8;
+      }
 
-      // Scan the .data section
-      m_cacheData.cls_Network = 0;
-      m_cacheData.cls_PlayerSpot = 0;
-      for (uintptr_t offset = 0; offset < dataSec.size && (!m_cacheData.cls_Network || !m_cacheData.cls_PlayerSpot);
-           offset += 8) {
-        const uintptr_t instPtr = *(uintptr_t*)&dataSegBuffer[offset];
-        Il2CppId classId;
-        if (!this->il2cpp_class_heuristicCheck(instPtr, classId))
+      // Read their class headers
+      for (auto& candidate : window) {
+        const uintptr_t instPtr = *(const uintptr_t*)&dataSegBuffer[candidate.offset];
+        candidate.request = {instPtr, &candidate.header, sizeof(candidate.header)};
+        m_rpm.async_submit(candidate.request);
+      }
+      m_rpm.async_reap();
+
+      for (const auto& candidate : window) {
+        if (!candidate.request.ok)
           continue;
 
-        if (!m_cacheData.cls_Network && classId.equal("Network", "")) {
-          m_cacheData.cls_Network = dataSec.offset + offset;
+        const uintptr_t instPtr = candidate.request.remoteAddr;
+        if (!m_dynData.pcls_Network && isClass(candidate.header, networkId, {"Network", ""})) {
+          m_cacheData.cls_Network = dataSec.offset + candidate.offset;
           m_dynData.pcls_Network = instPtr;
-        } else if (!m_cacheData.cls_PlayerSpot && classId.equal("PlayerSpot", "")) {
-          m_cacheData.cls_PlayerSpot = dataSec.offset + offset;
+        } else if (!m_dynData.pcls_PlayerSpot && isClass(candidate.header, playerSpotId, {"PlayerSpot", ""})) {
+          m_cacheData.cls_PlayerSpot = dataSec.offset + candidate.offset;
           m_dynData.pcls_PlayerSpot = instPtr;
         }
       }
     }
+
+    // Remember the findings for the next attempt, unless there is nothing left to find
+    if (m_dynData.pcls_Network && m_dynData.pcls_PlayerSpot) {
+      m_dataScan = {};
+    } else {
+      m_dataScan.cls_Network = m_cacheData.cls_Network;
+      m_dataScan.cls_PlayerSpot = m_cacheData.cls_PlayerSpot;
+      m_dataScan.typeInfoTable = m_cacheData.typeInfoTable;
+    }
   }
 
   // Checking the class instances is not needed, since either the cache is fully valid, or the invalid entries are
@@ -269,8 +500,8 @@ bool PhasMem::init()
     "[Debug]: [" CLASS_NAME " class offset: {:#016x}, " CLASS_NAME " class instance: {:#016x}].\n", CACHE_FIELD, \
     DYN_FIELD                                                                                                    \
   );                                                                                                             \
-  if (!CACHE_FIELD) {                                                                                            \
-    LOG_VERBF("[Error]: Couldn't find " CLASS_NAME "'s class offset.\n");                                        \
+  if (!DYN_FIELD) {                                                                                              \
+    LOG_VERBF("[Error]: Couldn't find " CLASS_NAME "'s class instance.\n");                                      \
     return false;                                                                                                \
   }
 
@@ -493,12 +724,26 @@ nextIter:
 
 #undef CHECK_FIELD_INITED
 
+  if constexpr (HAS_PAGE_CACHE) {
+    const auto cacheStats = m_rpm.getPageCacheStats();
+    LOG_VERBF(
+      "[Debug]: [page cache hits: {}, misses: {}, bypasses: {}]\n", cacheStats.hits, cacheStats.misses,
+      cacheStats.bypasses
+    );
+  }
+
+  // Nothing else is resolved from the metadata, so it doesn't have to stay resident while the fix is running
+  this->meta_dropResident();
+
   m_inited = true;
   return true;
 }
 
-bool PhasMem::fixWalkieTalkies(WalkieTalkieFixState state)
+template <RPMBackend RPM>
+bool BasicPhasMem<RPM>::fixWalkieTalkies(WalkieTalkieFixState state)
 {
+  const rpm_stats::ScopedTag statsTag(rpm_stats::TAG_FIX_TICK);
+
   if (!this->isOpen()) {
     LOG_VERB("[Error]: Not opened.\n");
     return false;
@@ -508,6 +753,10 @@ bool PhasMem::fixWalkieTalkies(WalkieTalkieFixState state)
     return false;
   }
 
+  // Don't serve anything from the previous tick
+  if constexpr (HAS_PAGE_CACHE)
+    m_rpm.beginEpoch();
+
   // Get the networked players
   il2cpp::System_Collections_Generic_List playersDataList;
   if (!m_rpm.read(m_dynData.pinst_Network, playersDataList, m_dynData.fld_Network_playersData, 0)) {
@@ -522,57 +771,80 @@ bool PhasMem::fixWalkieTalkies(WalkieTalkieFixState state)
     LOG_VERBF("[Error]: Invalid Network.playersData.Count (got: {}).\n", playersDataList.size);
     return false;
   }
-  std::array<uintptr_t, MAX_PLAYERS> playerDataArray;
-  if (!m_rpm.read_raw(
-        playersDataList.items + offsetof(il2cpp::Il2CppArray, items), playerDataArray.data(),
-        playersDataList.size * sizeof(uintptr_t)
-      )) {
-    LOG_VERB("[Error]: Couldn't read Network.playersData elements.\n");
+
+  // Read the elements of the list and the local player in one go. The latter is needed, so we can compare its
+  // WalkieTalkie's isGhostSpawned field (the ground truth) with the others.
+  // NOTE: index 0 of the chain arrays below belongs to the local player, the rest to the elements of the list.
+  std::array<uintptr_t, 1 + MAX_PLAYERS> chainPlayerSpots{};
+  std::array<uintptr_t, 1 + MAX_PLAYERS> chainPlayers{};
+  {
+    std::array<WinRPM::ReadRequest, 2> requests{{
+      {playersDataList.items + offsetof(il2cpp::Il2CppArray, items), &chainPlayerSpots[1],
+       playersDataList.size * sizeof(uintptr_t)},
+      {m_dynData.pinst_Network + m_dynData.fld_Network_localPlayer, &chainPlayers[0], sizeof(uintptr_t)},
+    }};
+    m_rpm.read_batch(requests);
+    if (!requests[0].ok) {
+      LOG_VERB("[Error]: Couldn't read Network.playersData elements.\n");
+      return false;
+    }
+    if (!requests[1].ok) {
+      LOG_VERB("[Error]: Couldn't read Network.localPlayer .\n");
+      return false;
+    }
+  }
+  const uintptr_t localPlayer = chainPlayers[0];
+
+  // Walk the Player -> PlayerAudio -> WalkieTalkie chains of every player level by level, so that each level only
+  // costs a single batched read instead of one read per player.
+  const size_t numChains = 1 + playersDataList.size;
+  std::array<WinRPM::ReadRequest, 1 + MAX_PLAYERS> requests;
+  const auto readLevel = [&]<typename T>(size_t first, const uintptr_t* bases, size_t offset, T* out) -> bool {
+    for (size_t i = first; i < numChains; ++i)
+      requests[i] = {bases[i] + offset, &out[i], sizeof(T)};
+    return m_rpm.read_batch({&requests[first], numChains - first}) == numChains - first;
+  };
+
+  if (!readLevel(1, chainPlayerSpots.data(), m_dynData.fld_PlayerSpot_player, chainPlayers.data())) {
+    LOG_VERB("[Error]: Couldn't read Network.playersData[i].player .\n");
     return false;
   }
 
-  // Get the local player, so we can compare its WalkieTalkie's isGhostSpawned field (the ground truth) with others
-  uintptr_t localPlayer;
-  if (!m_rpm.read(m_dynData.pinst_Network, localPlayer, m_dynData.fld_Network_localPlayer)) {
-    LOG_VERB("[Error]: Couldn't read Network.localPlayer .\n");
+  std::array<uintptr_t, 1 + MAX_PLAYERS> chainWalkieTalkies{};
+  if (!readLevel(0, chainPlayers.data(), m_dynData.fld_Player_playerAudio, chainWalkieTalkies.data()) ||
+      !readLevel(0, chainWalkieTalkies.data(), m_dynData.fld_PlayerAudio_walkieTalkie, chainWalkieTalkies.data())) {
+    LOG_VERB("[Error]: Couldn't read Network.playersData[i].player.playerAudio.walkieTalkie .\n");
     return false;
   }
 
-  bool localIsGhostSpawned;
-  if (!m_rpm.read(
-        localPlayer, localIsGhostSpawned, m_dynData.fld_Player_playerAudio, m_dynData.fld_PlayerAudio_walkieTalkie,
-        m_dynData.fld_WalkieTalkie_isGhostSpawned
+  std::array<bool, 1 + MAX_PLAYERS> chainIsGhostSpawned{};
+  if (!readLevel(
+        0, chainWalkieTalkies.data(), m_dynData.fld_WalkieTalkie_isGhostSpawned, chainIsGhostSpawned.data()
       )) {
-    LOG_VERB("[Error]: Couldn't read Network.localPlayer.playerAudio.walkieTalkie.isGhostSpawned .\n");
+    LOG_VERB("[Error]: Couldn't read Network.playersData[i].player.playerAudio.walkieTalkie.isGhostSpawned .\n");
     return false;
   }
+  const bool localIsGhostSpawned = chainIsGhostSpawned[0];
 
-  // Enumerate the networked players
+  // Collect the walkie-talkies that need to be fixed
+  struct Target {
+    int idx;
+    bool isGhostSpawned;
+    bool newIsGhostSpawned;
+    std::array<CompareRequest, 2> checks;
+  };
+  std::array<Target, MAX_PLAYERS> targets;
+  std::array<CompareWriteRequest, MAX_PLAYERS> writes;
+  size_t numTargets = 0;
   for (int i = 0; i < playersDataList.size; ++i) {
-    const auto playerSpotPtr = playerDataArray[i];
-
-    uintptr_t player;
-    if (!m_rpm.read(playerSpotPtr, player, m_dynData.fld_PlayerSpot_player)) {
-      LOG_VERB("[Error]: Couldn't read Network.playersData[i].player .\n");
-      return false;
-    }
+    const auto player = chainPlayers[1 + i];
 
     // Skip the local player (we could also just skip the first element of the list)
     if (player == localPlayer)
       continue;
 
-    // Get the remote player's WalkieTalkie's isGhostSpawned field
-    uintptr_t walkieTalkie;
-    if (!m_rpm.read(player, walkieTalkie, m_dynData.fld_Player_playerAudio, m_dynData.fld_PlayerAudio_walkieTalkie)) {
-      LOG_VERB("[Error]: Couldn't read Network.playersData[i].player.playerAudio.walkieTalkie .\n");
-      return false;
-    }
-
-    bool isGhostSpawned;
-    if (!m_rpm.read(walkieTalkie, isGhostSpawned, m_dynData.fld_WalkieTalkie_isGhostSpawned)) {
-      LOG_VERB("[Error]: Couldn't read Network.playersData[i].player.playerAudio.walkieTalkie.isGhostSpawned .\n");
-      return false;
-    }
+    const auto walkieTalkie = chainWalkieTalkies[1 + i];
+    const bool isGhostSpawned = chainIsGhostSpawned[1 + i];
 
     // Determine the new value to be written back
     bool newIsGhostSpawned;
@@ -591,32 +863,65 @@ bool PhasMem::fixWalkieTalkies(WalkieTalkieFixState state)
     if (isGhostSpawned == newIsGhostSpawned)
       continue;
 
+    // Only write if the WalkieTalkie object is still alive and unchanged by then. Writing into it after it has been
+    // destroyed and garbage collected could crash the game.
+    auto& target = targets[numTargets];
+    target.idx = i;
+    target.isGhostSpawned = isGhostSpawned;
+    target.newIsGhostSpawned = newIsGhostSpawned;
+    writes[numTargets++] = this->il2cpp_obj_prepareFieldWrite(
+      walkieTalkie, m_dynData.pcls_WalkieTalkie, m_dynData.fld_WalkieTalkie_isGhostSpawned, target.isGhostSpawned,
+      target.newIsGhostSpawned, target.checks
+    );
+  }
+  if (!numTargets)
+    return true;
+
+  // Write back the new values: every walkie-talkie is checked in a single batch, and then flipped in another one
+  m_rpm.compare_and_write_batch({writes.data(), numTargets});
+
+  // Log what we've done (this is when the account names get read, so that they don't delay the writes)
+  bool ok = true;
+  for (size_t t = 0; t < numTargets; ++t) {
+    const auto& target = targets[t];
+    const int i = target.idx;
+    if (writes[t].result == CompareWriteResult::Mismatch) {
+      LOG_VERBF("[Info]: The walkie-talkie of remote player (idx: {}) has changed since it was read, skipping.\n", i);
+      continue;
+    }
+
     // FIXME: Windows might not be able to display UTF-8 strings properly in the console.
     std::string accoundNameStr;
     uintptr_t accountNamePtr;
-    if (!m_rpm.read(playerSpotPtr + m_dynData.fld_PlayerSpot_accountName, accountNamePtr) ||
+    if (!m_rpm.read(chainPlayerSpots[1 + i] + m_dynData.fld_PlayerSpot_accountName, accountNamePtr) ||
         !this->il2cpp_string_readUTF8(accountNamePtr, accoundNameStr)) {
       LOG_VERB("[Error]: Couldn't read Network.playersData[i].accountName .\n");
       // Default to no name
       accoundNameStr.clear();
     }
 
-    // Write back the new value
-    // NOTE: technically, this *could* crash the game, if somehow the WalkieTalkie object gets destroyed and garbage
-    //  collected just before this memory write.
-    if (!m_rpm.write(walkieTalkie, newIsGhostSpawned, m_dynData.fld_WalkieTalkie_isGhostSpawned)) {
+    if (writes[t].result != CompareWriteResult::Written) {
       LOG_VERB("[Error]: Couldn't write to Network.playersData[i].player.playerAudio.walkieTalkie.isGhostSpawned .\n");
       LOG_CERRF("[Error]: Couldn't fix the walkie-talkie of remote player (idx: {}): '{}'.\n", i, accoundNameStr);
-      return false;
+      ok = false;
+      continue;
     }
 
     // Log that we've applied the fix
     LOG_CERRF("[Info]: Fixed the walkie-talkie of remote player (idx: {}): '{}'\n", i, accoundNameStr);
     LOG_VERBF(
-      "[Debug]: [remote isGhostSpawned: {} -> {}, local isGhostSpawned: {}]\n", isGhostSpawned, newIsGhostSpawned,
-      localIsGhostSpawned
+      "[Debug]: [remote isGhostSpawned: {} -> {}, local isGhostSpawned: {}]\n", target.isGhostSpawned,
+      target.newIsGhostSpawned, localIsGhostSpawned
     );
   }
 
-  return true;
-}
\ No newline at end of file
+  return ok;
+}
+
+template class BasicPhasMem<WinRPM>;
+template class BasicPhasMem<SelfRPM>;
+template class BasicPhasMem<SnapshotRPM>;
+template class BasicPhasMem<ReplayRPM>;
+#if __linux__
+template class BasicPhasMem<VmReadvRPM>;
+#endif
\ No newline at end of file
@@ -8,12 +8,33 @@
 #include <filesystem>
 #include <span>
 #include <functional>
+#include <memory>
 
 #include "il2cpp_rpm.h"
 
-class PhasMem : protected Il2CppRPM
+enum class PhasMemFixState {
+  ForceOff, // Sets the remote isGhostSpawned fields to true (forces the glitch to occur, for demonstration purposes)
+  ForceOn,  // Sets the remote isGhostSpawned fields to false (for demonstration purposes)
+  Auto      // Synchronizes the remote isGhostSpawned fields with the local player's
+};
+
+/**
+ * The remote memory is accessed through the RPM backend (see: rpm_backends.h).
+ */
+template <RPMBackend RPM>
+class BasicPhasMem : protected BasicIl2CppRPM<RPM>
 {
 protected:
+  using Il2CppRPM = BasicIl2CppRPM<RPM>;
+  using Il2CppRPM::m_rpm;
+  using Il2CppRPM::m_verbose;
+  using Il2CppRPM::m_gameAssemblyBase;
+  using Il2CppRPM::m_metadataView;
+  using Il2CppRPM::m_metadataRemote;
+
+  // Whether the backend has a page cache (see: WinRPM::enablePageCache)
+  static constexpr bool HAS_PAGE_CACHE = requires(RPM& rpm) { rpm.beginEpoch(); };
+
   /*
   The internal structure of Phasmo that we are after (after removing the BeeByte obfuscation):
 
@@ -64,6 +85,7 @@ protected:
   struct CacheData {
     uintptr_t cls_Network{};    // Offset to a pointer to Network's class instance in GameAssembly.dll
     uintptr_t cls_PlayerSpot{}; // Offset to a pointer to PlayerSpot's class instance in GameAssembly.dll
+    uintptr_t typeInfoTable{};  // Offset to a pointer to il2cpp's type info table in GameAssembly.dll
   } m_cacheData;
 
   /**
@@ -87,8 +109,25 @@ protected:
     uintptr_t pcls_PlayerSpot{};   // A pointer to PlayerSpot's class instance
   } m_dynData;
 
+  /**
+   * The state of the .data scan, kept across the failed init attempts (e.g. while the game is still loading), so that
+   * the next attempt only has to rescan the pages that have been written since (see: WinRPM::clearSoftDirty).
+   */
+  struct DataScanState {
+    uintptr_t addr{};                        // The remote address of the .data section
+    size_t size{};                           // The size of the .data section
+    std::unique_ptr<unsigned char[]> buffer; // The contents of the .data section, as of the previous attempt
+    bool softDirtyTracked{};                 // Whether the soft-dirty bits were cleared before it was last read
+    uintptr_t cls_Network{};                 // What the previous attempts have found (see: CacheData)
+    uintptr_t cls_PlayerSpot{};
+    uintptr_t typeInfoTable{};
+  } m_dataScan;
+
   bool m_inited = false;
 
+  // Remembers the processes that definitely aren't the game across open() attempts
+  WinRPM::ProcessDiscovery m_processDiscovery{.steamAppId = "739630"};
+
   // Settings
   std::filesystem::path m_cachePath = std::filesystem::temp_directory_path() / "phasmo_global_vc_fixer.cache";
   bool m_shouldLoadCache = true;
@@ -107,14 +146,60 @@ protected:
 public:
   static constexpr WinRPM::PathViewType PHASMO_EXE_NAME = WINRPM_PATH("Phasmophobia.exe");
   static constexpr auto MAX_PLAYERS = 4;
+  static constexpr size_t PAGE_CACHE_MAX_PAGES = 1024; // 4 MiB
 
-  PhasMem() = default;
-  ~PhasMem() { this->close(); }
+  BasicPhasMem() = default;
+  ~BasicPhasMem() { this->close(); }
 
   /**
    * Attempts to open Phasmophobia.exe and initialize everything (including finding the offsets).
    */
-  Il2CppRPM::OpenResult open();
+  Il2CppOpenResult open();
+
+  /**
+   * Same as open(), but with the PID of the game already known (see: ProcExecWatcher).
+   */
+  Il2CppOpenResult open(PID pid);
+
+  /**
+   * Opens a recording of the game instead of the game itself: a snapshot (see: snapshot.h), or a trace (see:
+   * rpm_trace.h).
+   */
+  Il2CppOpenResult openRecording(const std::filesystem::path& recordingPath)
+    requires std::same_as<RPM, SnapshotRPM> || std::same_as<RPM, ReplayRPM>;
+
+  /**
+   * Starts recording which pages of the game get touched from here on (see: captureSnapshot).
+   */
+  void startSnapshotCapture()
+    requires std::same_as<RPM, WinRPM>;
+
+  /**
+   * Captures a snapshot of the pages touched since startSnapshotCapture, so that the same init and fix can be replayed
+   * later without the game (see: openSnapshot).
+   */
+  bool captureSnapshot(const std::filesystem::path& snapshotPath)
+    requires std::same_as<RPM, WinRPM>;
+
+  /**
+   * Starts recording every read and write made to the game into a trace file (see: WinRPM::startTrace), so that the
+   * same init and fix can be replayed later without the game (see: openRecording).
+   */
+  inline bool startTrace(const std::filesystem::path& tracePath)
+    requires std::same_as<RPM, WinRPM>
+  {
+    return m_rpm.startTrace(tracePath);
+  }
+  inline void stopTrace()
+    requires std::same_as<RPM, WinRPM>
+  {
+    m_rpm.stopTrace();
+  }
+
+  /**
+   * Returns the memory access backend (e.g. for its statistics).
+   */
+  inline const RPM& getBackend() const { return m_rpm; }
 
   /**
    * Closes the handle to the game and resets the internal state.
@@ -136,11 +221,7 @@ public:
    */
   inline bool isInited() const { return m_inited; }
 
-  enum class WalkieTalkieFixState {
-    ForceOff, // Sets the remote isGhostSpawned fields to true (forces the glitch to occur, for demonstration purposes)
-    ForceOn,  // Sets the remote isGhostSpawned fields to false (for demonstration purposes)
-    Auto      // Synchronizes the remote isGhostSpawned fields with the local player's
-  };
+  using WalkieTalkieFixState = PhasMemFixState;
 
   /**
    * Looks for glitched WalkieTalkie instances on the remote players and attempts to fix them.
@@ -158,6 +239,18 @@ public:
   inline bool shouldSaveCache() const { return m_shouldSaveCache; }
   inline void setShouldSaveCache(bool shouldSaveCache) { m_shouldSaveCache = shouldSaveCache; }
 
+  using Il2CppRPM::getExitWaitHandle;
+  using Il2CppRPM::pollIsOpen;
   using Il2CppRPM::isVerbose;
   using Il2CppRPM::setVerbose;
-};
\ No newline at end of file
+};
+
+extern template class BasicPhasMem<WinRPM>;
+extern template class BasicPhasMem<SelfRPM>;
+extern template class BasicPhasMem<SnapshotRPM>;
+extern template class BasicPhasMem<ReplayRPM>;
+#if __linux__
+extern template class BasicPhasMem<VmReadvRPM>;
+#endif
+
+using PhasMem = BasicPhasMem<WinRPM>;
\ No newline at end of file
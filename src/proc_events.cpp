@@ -0,0 +1,205 @@
+#if __linux__
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+
+#include "proc_events.h"
+
+#if __linux__
+
+static bool sendMcastOp(int sock, proc_cn_mcast_op op)
+{
+  alignas(nlmsghdr) unsigned char buffer[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))]{};
+  auto* nlHeader = (nlmsghdr*)buffer;
+  nlHeader->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+  nlHeader->nlmsg_type = NLMSG_DONE;
+  auto* cnMsg = (cn_msg*)NLMSG_DATA(nlHeader);
+  cnMsg->id = {CN_IDX_PROC, CN_VAL_PROC};
+  cnMsg->len = sizeof(proc_cn_mcast_op);
+  *(proc_cn_mcast_op*)cnMsg->data = op;
+  return ::send(sock, buffer, nlHeader->nlmsg_len, MSG_DONTWAIT) == nlHeader->nlmsg_len;
+}
+
+bool ProcExecWatcher::open()
+{
+  this->close();
+
+  const int sock = ::socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+  if (sock < 0)
+    return false;
+
+  // Join the multicast group of the process connector
+  sockaddr_nl addr{};
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = CN_IDX_PROC;
+  if (::bind(sock, (sockaddr*)&addr, sizeof(addr)) != 0) {
+    ::close(sock);
+    return false;
+  }
+
+  // Ask the kernel to start sending the events
+  if (!sendMcastOp(sock, PROC_CN_MCAST_LISTEN)) {
+    ::close(sock);
+    return false;
+  }
+
+  // Wait for the acknowledgement, which tells whether we had the privileges.
+  //  The kernel silently ignores the request if we are not in the initial namespaces, hence the timeout.
+  constexpr int ackTimeoutMs = 500;
+  for (pollfd pfd{sock, POLLIN, 0};;) {
+    if (::poll(&pfd, 1, ackTimeoutMs) <= 0) {
+      ::close(sock);
+      return false;
+    }
+
+    alignas(nlmsghdr) unsigned char recvBuffer[4096];
+    const ssize_t recvSize = ::recv(sock, recvBuffer, sizeof(recvBuffer), 0);
+    if (recvSize <= 0) {
+      ::close(sock);
+      return false;
+    }
+
+    // Events of other processes might arrive before the acknowledgement
+    const auto* msg = (const nlmsghdr*)recvBuffer;
+    for (int len = recvSize; NLMSG_OK(msg, len); msg = NLMSG_NEXT(msg, len)) {
+      const auto* cnRecv = (const cn_msg*)NLMSG_DATA(msg);
+      if (cnRecv->id.idx != CN_IDX_PROC || cnRecv->len < sizeof(proc_event))
+        continue;
+      const auto* event = (const proc_event*)cnRecv->data;
+      if (event->what != proc_event::PROC_EVENT_NONE)
+        continue;
+
+      if (event->event_data.ack.err != 0) {
+        ::close(sock);
+        return false;
+      }
+
+      m_state.socket = sock;
+      return true;
+    }
+  }
+}
+
+void ProcExecWatcher::close()
+{
+  if (!this->isOpen())
+    return;
+
+  // Be polite, and tell the kernel that we no longer need the events
+  sendMcastOp(m_state.socket, PROC_CN_MCAST_IGNORE);
+
+  ::close(m_state.socket);
+  m_state = {};
+  m_pending.clear();
+}
+
+PID ProcExecWatcher::waitForProcess(WinRPM::PathViewType processFilename, std::chrono::milliseconds timeout)
+{
+  using clock = std::chrono::steady_clock;
+
+  if (!this->isOpen())
+    return 0;
+
+  const auto deadline = clock::now() + timeout;
+  auto nextPendingCheck = clock::now() + PENDING_RECHECK_DELAY;
+  for (;;) {
+    const auto now = clock::now();
+
+    // See what the Wine processes that were still starting up have turned into
+    if (now >= nextPendingCheck) {
+      nextPendingCheck = now + PENDING_RECHECK_DELAY;
+      for (auto it = m_pending.begin(); it != m_pending.end();) {
+        const auto match = WinRPM::matchProcess(it->first, processFilename);
+        if (match == WinRPM::ProcessMatch::Match) {
+          const PID pid = it->first;
+          m_pending.erase(it);
+          return pid;
+        }
+        if (match == WinRPM::ProcessMatch::NoMatch || now - it->second > PENDING_TIMEOUT)
+          it = m_pending.erase(it);
+        else
+          ++it;
+      }
+    }
+
+    if (now >= deadline)
+      return 0;
+
+    // Sleep until something happens
+    auto wakeUp = deadline;
+    if (!m_pending.empty())
+      wakeUp = std::min(wakeUp, nextPendingCheck);
+    const int timeoutMs = std::chrono::ceil<std::chrono::milliseconds>(wakeUp - now).count();
+    pollfd pfd{m_state.socket, POLLIN, 0};
+    const int pollResult = ::poll(&pfd, 1, timeoutMs);
+    if (pollResult == 0)
+      continue;
+    if (pollResult < 0) {
+      if (errno == EINTR)
+        return 0;
+      this->close();
+      return 0;
+    }
+
+    alignas(nlmsghdr) unsigned char recvBuffer[4096];
+    const ssize_t recvSize = ::recv(m_state.socket, recvBuffer, sizeof(recvBuffer), MSG_DONTWAIT);
+    if (recvSize <= 0) {
+      if (recvSize < 0 && (errno == EAGAIN || errno == EINTR))
+        continue;
+
+      // We've missed some events, so scan everything once to make sure that we don't miss the game
+      if (recvSize < 0 && errno == ENOBUFS) {
+        if (const PID pid = WinRPM::getPIDByFilename(processFilename))
+          return pid;
+        continue;
+      }
+
+      this->close();
+      return 0;
+    }
+
+    const auto* msg = (const nlmsghdr*)recvBuffer;
+    for (int len = recvSize; NLMSG_OK(msg, len); msg = NLMSG_NEXT(msg, len)) {
+      const auto* cnMsg = (const cn_msg*)NLMSG_DATA(msg);
+      if (cnMsg->id.idx != CN_IDX_PROC || cnMsg->len < sizeof(proc_event))
+        continue;
+      const auto* event = (const proc_event*)cnMsg->data;
+      if (event->what != proc_event::PROC_EVENT_EXEC)
+        continue;
+
+      const PID pid = event->event_data.exec.process_tgid;
+      switch (WinRPM::matchProcess(pid, processFilename)) {
+      case WinRPM::ProcessMatch::Match:
+        return pid;
+      case WinRPM::ProcessMatch::Pending:
+        m_pending.try_emplace(pid, clock::now());
+        break;
+      default:
+        break;
+      }
+    }
+  }
+}
+
+#elif _WIN32
+
+bool ProcExecWatcher::open()
+{
+  return false;
+}
+
+void ProcExecWatcher::close() {}
+
+PID ProcExecWatcher::waitForProcess(WinRPM::PathViewType processFilename, std::chrono::milliseconds timeout)
+{
+  return 0;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <unordered_map>
+#include <utility>
+
+#include "rpm.h"
+
+/**
+ * Gets notified by the kernel whenever a process executes a new program (through the netlink process connector), so
+ * that we don't have to periodically scan every running process while waiting for the game to start.
+ * Subscribing to the connector requires CAP_NET_ADMIN (and the initial namespaces), so it's not always available.
+ * On Windows, it's not implemented at all.
+ */
+class ProcExecWatcher
+{
+protected:
+  struct State {
+#if __linux__
+    int socket = -1;
+#endif
+  } m_state;
+
+  // Wine processes that haven't finished starting up yet (see: WinRPM::matchProcess), and when we've first seen them
+  std::unordered_map<PID, std::chrono::steady_clock::time_point> m_pending;
+
+public:
+  // How long to keep an eye on a Wine process that is still starting up
+  static constexpr std::chrono::seconds PENDING_TIMEOUT{30};
+  static constexpr std::chrono::milliseconds PENDING_RECHECK_DELAY{250};
+
+  ProcExecWatcher() noexcept = default;
+  ProcExecWatcher(const ProcExecWatcher&) = delete;
+  ProcExecWatcher& operator=(const ProcExecWatcher&) = delete;
+  ProcExecWatcher(ProcExecWatcher&& other) noexcept
+      : m_state(std::exchange(other.m_state, {})), m_pending(std::move(other.m_pending))
+  {
+  }
+  ProcExecWatcher& operator=(ProcExecWatcher&& other) noexcept
+  {
+    this->close();
+    m_state = std::exchange(other.m_state, {});
+    m_pending = std::move(other.m_pending);
+    return *this;
+  }
+
+  ~ProcExecWatcher() { this->close(); }
+
+  /**
+   * Subscribes to the process events. Returns false if we couldn't (e.g., due to a lack of privileges), in which case
+   * the caller should fall back to scanning the processes (see: WinRPM::getPIDByFilename).
+   */
+  bool open();
+
+  /**
+   * Unsubscribes from the process events.
+   */
+  void close();
+
+  /**
+   * Returns whether we are subscribed to the process events.
+   */
+  bool isOpen() const
+  {
+#if __linux__
+    return m_state.socket >= 0;
+#elif _WIN32
+    return false;
+#endif
+  }
+
+  /**
+   * Waits for a process with the given filename to start, but for no longer than the timeout. Returns its PID, or 0
+   * if no such process has started in time, or if the wait got interrupted by a signal. If an error occurs, the
+   * watcher gets closed, and 0 is returned.
+   * Processes that were already running before the watcher was opened won't be noticed.
+   */
+  PID waitForProcess(WinRPM::PathViewType processFilename, std::chrono::milliseconds timeout);
+};
\ No newline at end of file
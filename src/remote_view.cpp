@@ -0,0 +1,197 @@
+#if __linux__
+#include <fcntl.h>
+#include <linux/userfaultfd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <cstring>
+
+#include "remote_view.h"
+
+#if __linux__
+
+// How often the fault handler checks whether it should stop, in case it misses the wake up (see: close)
+static constexpr int STOP_POLL_INTERVAL_MS = 100;
+
+// How many times a page copy is attempted while the mappings are changing under it (see: resolveFault)
+static constexpr unsigned COPY_ATTEMPTS = 8;
+
+bool RemoteView::openLazy(MemRange range, PageFetcher fetchPage)
+{
+  // Unprivileged processes may only handle user mode faults (unless vm.unprivileged_userfaultfd is set), and kernels
+  // before 5.11 don't know about UFFD_USER_MODE_ONLY, so try with it first.
+#ifdef UFFD_USER_MODE_ONLY
+  int uffd = ::syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+  if (uffd < 0 && errno == EINVAL)
+    uffd = ::syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+#else
+  const int uffd = ::syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+#endif
+  if (uffd < 0)
+    return false;
+
+  uffdio_api api{};
+  api.api = UFFD_API;
+  const int stopFd = ::eventfd(0, EFD_CLOEXEC);
+  void* data = MAP_FAILED;
+  const auto fail = [&]() {
+    if (data != MAP_FAILED)
+      ::munmap(data, range.size());
+    if (stopFd >= 0)
+      ::close(stopFd);
+    ::close(uffd);
+    return false;
+  };
+  if (::ioctl(uffd, UFFDIO_API, &api) != 0 || stopFd < 0)
+    return fail();
+
+  // The pages are filled in with UFFDIO_COPY, which needs a writable mapping, even though we only ever read it
+  data = ::mmap(nullptr, range.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (data == MAP_FAILED)
+    return fail();
+
+  uffdio_register reg{};
+  reg.range = {(uintptr_t)data, range.size()};
+  reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+  if (::ioctl(uffd, UFFDIO_REGISTER, &reg) != 0)
+    return fail();
+
+  m_fetchPage = std::move(fetchPage);
+  m_uffd = uffd;
+  m_stopFd = stopFd;
+  m_data = (const unsigned char*)data;
+  m_range = range;
+  m_lazy = true;
+  m_handler = std::thread(&RemoteView::handleFaults, this);
+  return true;
+}
+
+void RemoteView::handleFaults()
+{
+  alignas(PAGE_SIZE) static thread_local unsigned char page[PAGE_SIZE];
+
+  pollfd fds[2] = {{m_uffd, POLLIN, 0}, {m_stopFd, POLLIN, 0}};
+  while (!m_stop.load(std::memory_order_acquire)) {
+    const int ready = ::poll(fds, 2, STOP_POLL_INTERVAL_MS);
+    if (ready < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    if (ready == 0 || fds[1].revents)
+      continue;
+
+    uffd_msg msg;
+    const ssize_t bytes = ::read(m_uffd, &msg, sizeof(msg));
+    if (bytes != sizeof(msg) || msg.event != UFFD_EVENT_PAGEFAULT)
+      continue;
+
+    // Fetch the page from the remote process. Unreadable pages are served as zeros, so that the faulting thread can
+    // carry on (it would be stuck otherwise).
+    const uintptr_t localPage = msg.arg.pagefault.address & ~(PAGE_SIZE - 1);
+    //  The counters are updated before the faulting thread is woken up, so that it already sees them.
+    const bool fetched = m_fetchPage(m_range.start + (localPage - (uintptr_t)m_data), page);
+    if (!fetched) {
+      ::memset(page, 0, PAGE_SIZE);
+      m_failedPages.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_fetchedPages.fetch_add(1, std::memory_order_relaxed);
+    this->resolveFault(localPage, page, fetched);
+  }
+}
+
+void RemoteView::resolveFault(uintptr_t localPage, const void* pageData, bool fetched)
+{
+  // EAGAIN means that the mappings were changing while the page was being copied, so it's simply retried
+  int err = 0;
+  for (unsigned attempt = 0; attempt < COPY_ATTEMPTS; ++attempt) {
+    uffdio_copy copy{};
+    copy.dst = localPage;
+    copy.src = (uintptr_t)pageData;
+    copy.len = PAGE_SIZE;
+    if (::ioctl(m_uffd, UFFDIO_COPY, &copy) == 0)
+      return;
+    if ((err = errno) != EAGAIN)
+      break;
+  }
+
+  // EEXIST means that the page has been filled in already (e.g. the same fault was reported twice). Otherwise, the page
+  // is served as zeros, like the ones that couldn't be fetched.
+  if (err != EEXIST) {
+    if (fetched)
+      m_failedPages.fetch_add(1, std::memory_order_relaxed);
+    uffdio_zeropage zeropage{};
+    zeropage.range = {localPage, PAGE_SIZE};
+    if (::ioctl(m_uffd, UFFDIO_ZEROPAGE, &zeropage) == 0)
+      return;
+  }
+
+  // Either way, the faulting thread mustn't be left waiting: if the page is still missing, it simply faults again
+  uffdio_range wake{localPage, PAGE_SIZE};
+  ::ioctl(m_uffd, UFFDIO_WAKE, &wake);
+}
+
+void RemoteView::invalidate()
+{
+  // Dropped pages are missing again, so their next touch faults
+  if (m_lazy)
+    ::madvise((void*)m_data, m_range.size(), MADV_DONTNEED);
+}
+
+void RemoteView::populate() const
+{
+  if (!m_lazy)
+    return;
+  for (size_t offset = 0; offset < m_range.size(); offset += PAGE_SIZE)
+    (void)*(const volatile unsigned char*)(m_data + offset);
+}
+
+void RemoteView::close()
+{
+  if (!this->isOpen())
+    return;
+
+  if (m_lazy) {
+    // Wake the handler up, so that it notices m_stop right away (if that fails, it still does on its next poll timeout)
+    m_stop.store(true, std::memory_order_release);
+    const uint64_t one = 1;
+    while (::write(m_stopFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+    m_handler.join();
+    ::munmap((void*)m_data, m_range.size());
+    ::close(m_uffd);
+    ::close(m_stopFd);
+    m_fetchPage = {};
+    m_uffd = -1;
+    m_stopFd = -1;
+    m_stop = false;
+    m_fetchedPages = 0;
+    m_failedPages = 0;
+  }
+
+  m_buffer.reset();
+  m_data = nullptr;
+  m_range = {};
+  m_lazy = false;
+}
+
+#elif _WIN32
+
+void RemoteView::invalidate() {}
+
+void RemoteView::populate() const {}
+
+void RemoteView::close()
+{
+  m_buffer.reset();
+  m_data = nullptr;
+  m_range = {};
+  m_lazy = false;
+}
+
+#endif
\ No newline at end of file
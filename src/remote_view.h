@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <thread>
+#include <utility>
+
+#include "rpm.h"
+#include "rpm_backends.h"
+
+/**
+ * A read-only local view of a remote memory region (e.g. the game's global-metadata.dat mapping, see:
+ * BasicIl2CppRPM::meta_loadFromRemote), so that pointer-walking code can use plain loads on remote data.
+ *
+ * On Linux, the view is backed by userfaultfd: the range is only reserved up front, and each page is fetched from the
+ * remote process (with the backend's read_batch) by a handler thread the first time it's touched, so only the touched
+ * pages cost anything. Pages that can't be read are served as zeros. A fetched page is a snapshot of the remote one,
+ * which can be refreshed with invalidate.
+ * If userfaultfd is not permitted (e.g. vm.unprivileged_userfaultfd = 0 on kernels without UFFD_USER_MODE_ONLY), and
+ * on Windows, the whole region is copied up front instead (see: isLazy), which is slower, but works the same.
+ *
+ * NOTE: the handler thread uses the backend while the faulting thread waits for it, so a lazy view must only be
+ * touched by the thread that uses the backend, and it must be closed before the backend is. Its memory may only be
+ * faulted in from user mode too, so it must not be handed to syscalls (e.g. write) before it has been touched (see:
+ * populate).
+ */
+class RemoteView
+{
+public:
+  static constexpr size_t PAGE_SIZE = PageResidency::PAGE_SIZE;
+
+protected:
+  MemRange m_range{};
+  const unsigned char* m_data = nullptr;
+  bool m_lazy = false;
+
+  // Eager views
+  std::unique_ptr<unsigned char[]> m_buffer;
+
+#if __linux__
+  // Lazy views
+  using PageFetcher = std::function<bool(uintptr_t remoteAddr, void* dataOut)>; // Reads a whole remote page
+  PageFetcher m_fetchPage;
+  int m_uffd = -1;
+  int m_stopFd = -1;
+  std::atomic<bool> m_stop{};
+  std::thread m_handler;
+  std::atomic<uint64_t> m_fetchedPages{};
+  std::atomic<uint64_t> m_failedPages{};
+
+  bool openLazy(MemRange range, PageFetcher fetchPage);
+  void handleFaults();
+
+  /**
+   * Fills in a missing page of the view, and wakes up the thread(s) waiting for it. If the page can't be filled in,
+   * then it's served as zeros instead (and counted as a failed one, unless it has been already, see: fetched).
+   */
+  void resolveFault(uintptr_t localPage, const void* pageData, bool fetched);
+#endif
+
+public:
+  RemoteView() noexcept = default;
+  ~RemoteView() { this->close(); }
+
+  RemoteView(const RemoteView&) = delete;
+  RemoteView& operator=(const RemoteView&) = delete;
+
+  /**
+   * Creates a view of the given remote range (whose bounds are rounded out to pages) of the process opened by rpm.
+   * Unless allowEager is set, it fails instead of copying the whole range up front when the view can't be lazy.
+   * Return indicates success. Previously opened views will be automatically closed.
+   */
+  template <RPMBackend RPM>
+  bool open(RPM& rpm, MemRange range, bool allowEager = true)
+  {
+    this->close();
+
+    if (!rpm.isOpen() || range.empty())
+      return false;
+    range = {range.start & ~(PAGE_SIZE - 1), (range.end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1)};
+
+#if __linux__
+    // read_batch always reads the remote process directly (bypassing the page cache of WinRPM), and it falls back to
+    // the other means of reading if process_vm_readv is unavailable
+    const auto fetchPage = [&rpm](uintptr_t remoteAddr, void* dataOut) {
+      WinRPM::ReadRequest request{remoteAddr, dataOut, PAGE_SIZE};
+      return rpm.read_batch(std::span{&request, 1}) == 1;
+    };
+    if (this->openLazy(range, fetchPage))
+      return true;
+#endif
+    if (!allowEager)
+      return false;
+
+    auto buffer = std::make_unique_for_overwrite<unsigned char[]>(range.size());
+    if (!rpm.read_large(range.start, buffer.get(), range.size()).numOk)
+      return false;
+    m_buffer = std::move(buffer);
+    m_data = m_buffer.get();
+    m_range = range;
+    m_lazy = false;
+    return true;
+  }
+
+  /**
+   * Releases the view.
+   */
+  void close();
+  inline bool isOpen() const { return m_data != nullptr; }
+  explicit inline operator bool() const { return isOpen(); }
+
+  /**
+   * Returns whether the pages are fetched on first touch, rather than copied up front.
+   */
+  inline bool isLazy() const { return m_lazy; }
+
+  /**
+   * Drops the fetched pages, so that they are fetched again on their next touch. Eager views can't be refreshed.
+   */
+  void invalidate();
+
+  /**
+   * Touches every page of a lazy view, so that all of them are fetched (e.g. before handing the view to a syscall).
+   */
+  void populate() const;
+
+  inline const unsigned char* data() const { return m_data; }
+  inline size_t size() const { return m_range.size(); }
+  inline const MemRange& range() const { return m_range; }
+
+  /**
+   * Maps a remote pointer inside the region to a local pointer inside the view, or returns a null pointer.
+   */
+  template <typename T>
+  inline const T* remoteToLocal(uintptr_t remotePtr) const
+  {
+    if (!m_range.in(remotePtr))
+      return nullptr;
+    return (const T*)(m_data + (remotePtr - m_range.start));
+  }
+
+  /**
+   * Returns the number of pages fetched (and the number of those that couldn't be read) by a lazy view so far.
+   */
+#if __linux__
+  inline uint64_t getFetchedPages() const { return m_fetchedPages.load(std::memory_order_relaxed); }
+  inline uint64_t getFailedPages() const { return m_failedPages.load(std::memory_order_relaxed); }
+#else
+  inline uint64_t getFetchedPages() const { return 0; }
+  inline uint64_t getFailedPages() const { return 0; }
+#endif
+};
\ No newline at end of file
@@ -4,7 +4,13 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <poll.h>
+#include <linux/io_uring.h>
 #include <cerrno>
+#include <climits>
 #include <linux/limits.h>
 #elif _WIN32
 #define _AMD64_
@@ -19,67 +25,184 @@
 #include <psapi.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
 #include "rpm.h"
+#include "rpm_stats.h"
 
 #if __linux__
 
-PID WinRPM::getPIDByFilename(PathViewType processFilename)
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+WinRPM::ProcessMatch WinRPM::matchProcess(PID pid, PathViewType processFilename)
+{
+  char path[32];
+
+  // Check the process name
+  {
+    ::snprintf(path, sizeof(path), "/proc/%u/exe", pid);
+    std::error_code fec;
+    const auto exePath = std::filesystem::read_symlink(path, fec);
+    if (fec)
+      return WinRPM::ProcessMatch::NoMatch;
+    const auto exeFilename = exePath.filename();
+
+    // Look for the wine preloader
+    if (exeFilename != "wine64-preloader" && exeFilename != "wine-preloader")
+      return WinRPM::ProcessMatch::NoMatch;
+  }
+
+  // Check the win exe name, which is contained in argv[0]
+  {
+    // Read argv[0]
+    ::snprintf(path, sizeof(path), "/proc/%u/cmdline", pid);
+    std::string argv0;
+    if (!std::getline(std::ifstream(path), argv0, '\0'))
+      return WinRPM::ProcessMatch::NoMatch;
+
+    // Find the filename contained in argv[0]
+    const auto slashPos = argv0.find_last_of("\\/");
+    const auto argv0Filename = std::string_view{argv0}.substr(slashPos == argv0.npos ? 0 : slashPos + 1);
+    if (argv0Filename == processFilename)
+      return WinRPM::ProcessMatch::Match;
+
+    // Wine only replaces argv with the one of the Windows process once it has started up
+    if (argv0Filename.starts_with("wine"))
+      return WinRPM::ProcessMatch::Pending;
+  }
+
+  return WinRPM::ProcessMatch::NoMatch;
+}
+
+/**
+ * Reads the comm and the start time of a process from /proc/<pid>/stat.
+ */
+static bool readProcStat(PID pid, std::array<char, 16>& comm, unsigned long long& startTime)
+{
+  char path[32];
+  ::snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+  const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  char buffer[512];
+  const ssize_t size = ::read(fd, buffer, sizeof(buffer) - 1);
+  ::close(fd);
+  if (size <= 0)
+    return false;
+  buffer[size] = '\0';
+
+  // The comm is enclosed in parentheses, but it might contain parentheses itself
+  const char* commStart = ::strchr(buffer, '(');
+  const char* commEnd = ::strrchr(buffer, ')');
+  if (!commStart || !commEnd || commEnd < commStart)
+    return false;
+  comm = {};
+  ::memcpy(comm.data(), commStart + 1, std::min<size_t>(commEnd - commStart - 1, comm.size() - 1));
+
+  // The start time is the 22nd field, and the fields after the comm start from the 3rd
+  const char* field = commEnd + 1;
+  for (int i = 3; i < 22; ++i) {
+    field = ::strchr(field + 1, ' ');
+    if (!field)
+      return false;
+  }
+  startTime = ::strtoull(field + 1, nullptr, 10);
+  return true;
+}
+
+/**
+ * Returns whether the SteamAppId env var of a process is set to something other than the given app id.
+ */
+static bool isOtherSteamApp(PID pid, std::string_view steamAppId)
+{
+  constexpr std::string_view varPrefix = "SteamAppId=";
+  char path[32];
+  ::snprintf(path, sizeof(path), "/proc/%u/environ", pid);
+  std::ifstream environ(path);
+  for (std::string var; std::getline(environ, var, '\0');) {
+    if (var.starts_with(varPrefix))
+      return std::string_view{var}.substr(varPrefix.size()) != steamAppId;
+  }
+  return false;
+}
+
+PID WinRPM::getPIDByFilename(PathViewType processFilename, ProcessDiscovery& discovery)
 {
   // Alternatively, without procfs: ::readproc()
 
+  // Once Wine has started up, it sets the comm to the (truncated) name of the Windows executable
+  std::array<char, 16> targetComm{};
+  processFilename.copy(targetComm.data(), targetComm.size() - 1);
+
+  DIR* procDir = ::opendir("/proc");
+  if (!procDir)
+    return 0;
+
   // Enumerate the processes
-  for (const auto& proc : std::filesystem::directory_iterator("/proc")) {
-    if (!proc.is_directory())
+  PID found = 0;
+  const auto generation = ++discovery.generation;
+  while (const dirent* entry = ::readdir(procDir)) {
+    if (entry->d_type != DT_DIR)
       continue;
-    const auto& procPath = proc.path();
-    PID pid = 0;
-    {
-      const auto PIDstr = procPath.filename();
-      const auto* PIDcstr = PIDstr.c_str();
-
-      // Fast fail
-      if (!('0' < PIDcstr[0] && PIDcstr[0] <= '9'))
-        continue;
 
-      // Parse PID
-      //  Entries in /proc/* that start with a number should be just a number, and they should represent a process.
-      errno = 0;
-      pid = ::strtoul(PIDcstr, NULL, 10);
-      if (errno != 0)
-        continue;
-    }
+    // Fast fail
+    const char* PIDcstr = entry->d_name;
+    if (!('0' < PIDcstr[0] && PIDcstr[0] <= '9'))
+      continue;
 
-    // Check the process name
-    {
-      std::error_code fec;
-      const auto exePath = std::filesystem::read_symlink(procPath / "exe", fec);
-      if (fec)
-        continue;
-      const auto exeFilename = exePath.filename();
+    // Parse PID
+    //  Entries in /proc/* that start with a number should be just a number, and they should represent a process.
+    errno = 0;
+    const PID pid = ::strtoul(PIDcstr, NULL, 10);
+    if (errno != 0)
+      continue;
 
-      // Look for the wine preloader
-      if (exeFilename != "wine64-preloader" && exeFilename != "wine-preloader")
-        continue;
+    // Skip the processes that we've already rejected (as long as they haven't exec'd since)
+    std::array<char, 16> comm;
+    unsigned long long startTime;
+    if (!readProcStat(pid, comm, startTime))
+      continue;
+    if (const auto it = discovery.rejected.find(pid);
+        it != discovery.rejected.end() && it->second.startTime == startTime && it->second.comm == comm) {
+      it->second.generation = generation;
+      continue;
     }
 
-    // Check the win exe name, which is contained in argv[0]
-    {
-      // Read argv[0]
-      std::string argv0;
-      if (!std::getline(std::ifstream(procPath / "cmdline"), argv0, '\0'))
-        continue;
-
-      // Find the filename contained in argv[0]
-      const auto slashPos = argv0.find_last_of("\\/");
-      if (argv0.compare(slashPos == argv0.npos ? 0 : slashPos + 1, argv0.npos, processFilename))
-        continue;
+    // Cheap checks first
+    //  Wine processes that are still starting up (or are about to exec into the preloader) can't be rejected by their
+    //  comm alone. Once they are running something else, they are rejected just like any other process: whatever they
+    //  do next (exec, or Wine renaming them after the Windows executable) changes their comm.
+    const bool isWine = std::string_view{comm.data()}.starts_with("wine");
+    bool reject = !isWine && comm != targetComm;
+    if (!reject && !discovery.steamAppId.empty())
+      reject = isOtherSteamApp(pid, discovery.steamAppId);
+
+    if (!reject) {
+      const auto match = WinRPM::matchProcess(pid, processFilename);
+      if (match == WinRPM::ProcessMatch::Match) {
+        found = pid;
+        break;
+      }
+      reject = match == WinRPM::ProcessMatch::NoMatch;
     }
 
-    // Try to open the handle
-    return pid;
+    if (reject)
+      discovery.rejected.insert_or_assign(pid, ProcessDiscovery::Rejected{startTime, comm, generation});
+    else
+      discovery.rejected.erase(pid);
   }
+  ::closedir(procDir);
 
-  return 0;
+  // Forget about the processes that have exited
+  if (!found)
+    std::erase_if(discovery.rejected, [=](const auto& entry) { return entry.second.generation != generation; });
+
+  return found;
 }
 
 WinRPM::OpenResult WinRPM::open(PID pid)
@@ -87,18 +210,34 @@ WinRPM::OpenResult WinRPM::open(PID pid)
   // Close old
   this->close();
 
+  // Track the process with a pidfd (Linux 5.3+) first, so we can reliably tell whether the mem handle opened after it
+  // belongs to the same process. If pidfds are not supported, we'll fall back to probing the mem handle.
+  const int pidfd = (int)::syscall(SYS_pidfd_open, pid, 0);
+  if (pidfd < 0 && errno == ESRCH)
+    return WinRPM::OpenResult::NotFound;
+
   // Open new
   char buffer[32];
   ::snprintf(buffer, sizeof(buffer), "/proc/%u/mem", pid);
-  m_state.handle = ::open(buffer, O_RDWR | O_LARGEFILE);
-  if (m_state.handle < 0) {
-    if (errno == EACCES)
+  const int handle = ::open(buffer, O_RDWR | O_LARGEFILE);
+  if (handle < 0) {
+    const int err = errno;
+    if (pidfd >= 0)
+      ::close(pidfd);
+    if (err == EACCES)
       return WinRPM::OpenResult::NoPrivileges;
-    if (errno == ENOENT)
+    if (err == ENOENT)
       return WinRPM::OpenResult::NotFound;
     return WinRPM::OpenResult::Error;
   }
   m_state.pid = pid;
+  m_state.handle = handle;
+  m_state.pidfd = pidfd;
+
+  // If the process has exited in the meantime, then its PID might have been reassigned before we opened its mem.
+  if (!this->pollIsOpen())
+    return WinRPM::OpenResult::NotFound;
+
   return WinRPM::OpenResult::Ok;
 }
 
@@ -109,74 +248,108 @@ WinRPM::ModuleInfo WinRPM::getModuleInfo(PathViewType moduleName)
   return {info.range.start, std::move(info.path)};
 }
 
-WinRPM::MappedFileInfo WinRPM::getMappedFileInfo(PathViewType filename)
+static bool parseHex(const char*& it, const char* end, uint64_t& value)
 {
-  if (!this->isOpen())
-    return {};
+  const char* begin = it;
+  value = 0;
+  for (; it < end; ++it) {
+    const char c = *it;
+    if ('0' <= c && c <= '9')
+      value = (value << 4) | (c - '0');
+    else if ('a' <= c && c <= 'f')
+      value = (value << 4) | (c - 'a' + 10);
+    else
+      break;
+  }
+  return it != begin;
+}
 
-  char buffer[128 + PATH_MAX];
-  ::sprintf(buffer, "/proc/%u/maps", m_state.pid);
-  FILE* fpMaps = ::fopen(buffer, "r");
+bool WinRPM::queryRegions(RegionIndex& index)
+{
+  index.clear();
+  if (!this->isOpen())
+    return false;
 
-  if (!fpMaps)
-    return {};
+  char path[32];
+  ::snprintf(path, sizeof(path), "/proc/%u/maps", m_state.pid);
+  const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
 
-  // Now that we have opened *a* /proc/*/maps, check whether our mem handle is still valid. Because if it's not, then
-  // that means that our process has been closed and its PID has been reassigned, and thus we should just exit out.
+  // Now that we have opened *a* /proc/*/maps, check whether our process is still alive. Because if it's not, then its
+  // PID might have been reassigned, and thus we should just exit out. Otherwise its PID is still taken, so the maps
+  // must belong to our process.
   if (!this->pollIsOpen()) {
-    ::fclose(fpMaps);
-    return {};
+    ::close(fd);
+    return false;
   }
 
-  while (::fgets(buffer, sizeof(buffer), fpMaps)) {
-    // Parse the map
-    char perms[5];
-    uintptr_t addrStart, addrEnd;
-    unsigned long long fileOffset, inode;
-    unsigned devMajor, devMinor;
-    int pathPos;
-    if (::sscanf(
-          buffer, "%lx-%lx %4s %llx %x:%x %llu%n", &addrStart, &addrEnd, perms, &fileOffset, &devMajor, &devMinor,
-          &inode, &pathPos
-        ) < 7)
-      continue;
-
-    // We are looking for the base address
-    if (fileOffset != 0)
-      continue;
-
-    // Swallow the whitespaces before the path
-    const char* pathBegin = &buffer[pathPos];
-    while (*pathBegin == ' ' || *pathBegin == '\t')
-      pathBegin++;
-
-    std::string_view path{pathBegin};
-
-    // Swallow the new line from ::fgets
-    if (!path.empty() && path[path.size() - 1] == '\n')
-      path.remove_suffix(1);
-
-    // Fast fail
-    if (path.size() < filename.size())
-      continue;
-
-    // Check for a filename match (might be slightly faster than creating an std::filesystem::path every time)
-    const auto slashPos = path.rfind(L'/');
-    if (!path.compare(slashPos == path.npos ? 0 : slashPos + 1, path.npos, filename)) {
-      ::fclose(fpMaps);
-      return {{addrStart, addrEnd}, path};
+  // Slurp the whole thing, so that we can parse it without any more syscalls
+  std::string maps;
+  maps.resize(256 * 1024);
+  for (size_t size = 0;;) {
+    if (size == maps.size())
+      maps.resize(2 * maps.size());
+    const ssize_t readSize = ::read(fd, maps.data() + size, maps.size() - size);
+    if (readSize < 0) {
+      ::close(fd);
+      return false;
     }
+    if (readSize == 0) {
+      maps.resize(size);
+      break;
+    }
+    size += readSize;
   }
+  ::close(fd);
+
+  // Each line looks like: "<start>-<end> <rwxp> <offset> <dev> <inode>   <path>"
+  for (const char *it = maps.data(), *end = maps.data() + maps.size(); it < end;) {
+    const char* lineEnd = (const char*)::memchr(it, '\n', end - it);
+    if (!lineEnd)
+      lineEnd = end;
+
+    uint64_t start, stop, fileOffset;
+    if (parseHex(it, lineEnd, start) && it < lineEnd && *it++ == '-' && parseHex(it, lineEnd, stop) &&
+        lineEnd - it >= 6 && *it++ == ' ') {
+      uint8_t perms = 0;
+      perms |= (it[0] == 'r') ? RegionIndex::PERM_READ : 0;
+      perms |= (it[1] == 'w') ? RegionIndex::PERM_WRITE : 0;
+      perms |= (it[2] == 'x') ? RegionIndex::PERM_EXEC : 0;
+      perms |= (it[3] == 's') ? RegionIndex::PERM_SHARED : 0;
+      it += 5;
+      if (parseHex(it, lineEnd, fileOffset)) {
+        // Skip the device and the inode, then the whitespaces before the path
+        for (int fields = 0; it < lineEnd && fields < 2; ++fields) {
+          while (it < lineEnd && *it == ' ')
+            ++it;
+          while (it < lineEnd && *it != ' ')
+            ++it;
+        }
+        while (it < lineEnd && *it == ' ')
+          ++it;
+        index.add({start, stop}, perms, fileOffset, {it, (size_t)(lineEnd - it)});
+      }
+    }
 
-  ::fclose(fpMaps);
-  return {};
+    it = lineEnd + 1;
+  }
+
+  return true;
 }
 
 void WinRPM::close()
 {
+  // The in-flight requests reference both our handle and their buffers, so wait for them
+  this->async_reap();
+  this->async_teardown();
+  this->stopTrace();
+  this->invalidate();
   if (!this->isOpen())
     return;
   ::close(m_state.handle);
+  if (m_state.pidfd >= 0)
+    ::close(m_state.pidfd);
   m_state = {};
 }
 
@@ -185,10 +358,19 @@ bool WinRPM::pollIsOpen()
   if (!this->isOpen())
     return false;
 
-  // Explanation:
+  // The pidfd becomes readable once the process exits, so this costs no memory access at all.
+  if (m_state.pidfd >= 0) {
+    pollfd pfd{m_state.pidfd, POLLIN, 0};
+    if (::poll(&pfd, 1, 0) > 0) {
+      this->close();
+      return false;
+    }
+    return true;
+  }
+
+  // Fallback explanation:
   //  Reading non-zero amount of bytes from /proc/*/mem will either return -1 (+ set errno), the number of bytes read
   //  (a non-zero number) or 0. The 0 is due to an early exit if the process got closed.
-  // I'm not aware of a nicer way of checking whether the process is still running.
   char dummy;
   if (::pread(m_state.handle, &dummy, sizeof(dummy), 0) == 0) {
     this->close();
@@ -197,7 +379,7 @@ bool WinRPM::pollIsOpen()
   return true;
 }
 
-bool WinRPM::read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
+bool WinRPM::read_raw_uncached(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
 {
   if (!this->isOpen())
     return false;
@@ -207,18 +389,22 @@ bool WinRPM::read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
     return this->pollIsOpen();
 
   ssize_t bytes{};
+  ++m_syscalls;
   if ((bytes = ::pread(m_state.handle, dataOut, dataSize, remoteAddr)) == -1)
     return false;
 
-  // See: the comment in pollIsOpen
+  // The address space is gone, so the process is exiting (see: the comment in pollIsOpen)
   if (!bytes) {
-    this->close();
+    this->pollIsOpen();
     return false;
   }
-  return bytes == dataSize;
+  if (bytes != dataSize)
+    return false;
+  this->markTouched(remoteAddr, dataSize);
+  return true;
 }
 
-bool WinRPM::write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize)
+bool WinRPM::write_raw_uncached(uintptr_t remoteAddr, const void* dataIn, size_t dataSize)
 {
   if (!this->isOpen())
     return false;
@@ -228,20 +414,446 @@ bool WinRPM::write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize
     return this->pollIsOpen();
 
   ssize_t bytes{};
+  ++m_syscalls;
   if ((bytes = ::pwrite(m_state.handle, dataIn, dataSize, remoteAddr)) == -1)
     return false;
 
-  // See: the comment in pollIsOpen
+  // The address space is gone, so the process is exiting (see: the comment in pollIsOpen)
   if (!bytes) {
-    this->close();
+    this->pollIsOpen();
     return false;
   }
-  return bytes == dataSize;
+  if (bytes != dataSize)
+    return false;
+  this->markTouched(remoteAddr, dataSize);
+  return true;
+}
+
+bool WinRPM::read_raw_threadsafe(uintptr_t remoteAddr, void* dataOut, size_t dataSize) const
+{
+  return ::pread(m_state.handle, dataOut, dataSize, remoteAddr) == (ssize_t)dataSize;
+}
+
+bool WinRPM::queryPageResidency(uintptr_t remoteAddr, size_t dataSize, PageResidency& residency)
+{
+  residency = {};
+  if (!this->isOpen() || !dataSize)
+    return false;
+
+  // See: https://www.kernel.org/doc/Documentation/vm/pagemap.txt
+  //  Each page has a 64 bit entry, and reading the flags below only requires ptrace access (the PFNs would require
+  //  CAP_SYS_ADMIN, but we don't need them).
+  constexpr uint64_t PM_PRESENT = 1ull << 63;
+  constexpr uint64_t PM_SWAPPED = 1ull << 62;
+  constexpr uint64_t PM_FILE = 1ull << 61;
+  constexpr uint64_t PM_SOFT_DIRTY = 1ull << 55;
+
+  char pagemapPath[64];
+  ::snprintf(pagemapPath, sizeof(pagemapPath), "/proc/%u/pagemap", m_state.pid);
+  const int fd = ::open(pagemapPath, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  const uintptr_t firstPage = remoteAddr & ~(PageResidency::PAGE_SIZE - 1);
+  const size_t numPages = (remoteAddr + dataSize - firstPage + PageResidency::PAGE_SIZE - 1) / PageResidency::PAGE_SIZE;
+  std::vector<uint64_t> entries(numPages);
+  ++m_syscalls;
+  const ssize_t bytes = ::pread(
+    fd, entries.data(), numPages * sizeof(uint64_t), (firstPage / PageResidency::PAGE_SIZE) * sizeof(uint64_t)
+  );
+  ::close(fd);
+  if (bytes != (ssize_t)(numPages * sizeof(uint64_t)))
+    return false;
+
+  residency.firstPage = firstPage;
+  residency.pages.resize(numPages);
+  for (size_t i = 0; i < numPages; ++i) {
+    const uint64_t entry = entries[i];
+    residency.pages[i] = ((entry & PM_PRESENT) ? PageResidency::PAGE_PRESENT : 0) |
+                         ((entry & PM_SWAPPED) ? PageResidency::PAGE_SWAPPED : 0) |
+                         ((entry & PM_FILE) ? PageResidency::PAGE_FILE : 0) |
+                         ((entry & PM_SOFT_DIRTY) ? PageResidency::PAGE_SOFT_DIRTY : 0);
+  }
+  return true;
+}
+
+/**
+ * Returns whether the kernel tracks soft-dirty bits. Without CONFIG_MEM_SOFT_DIRTY, clear_refs still accepts "4" (it
+ * just doesn't do anything), and the bits are never set, so it's checked on a page of our own: pages start out
+ * soft-dirty, and we never clear our own bits.
+ */
+static bool isSoftDirtySupported()
+{
+  static const bool supported = []() {
+    static volatile uint64_t probe = 1;
+    probe = probe + 1;
+
+    const int fd = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return false;
+    uint64_t entry = 0;
+    const off_t entryOffset = ((uintptr_t)&probe / PageResidency::PAGE_SIZE) * sizeof(entry);
+    const bool ok = ::pread(fd, &entry, sizeof(entry), entryOffset) == sizeof(entry);
+    ::close(fd);
+    return ok && (entry & (1ull << 55));
+  }();
+  return supported;
+}
+
+bool WinRPM::clearSoftDirty()
+{
+  if (!this->isOpen() || !isSoftDirtySupported())
+    return false;
+
+  // See: https://www.kernel.org/doc/Documentation/admin-guide/mm/soft-dirty.rst
+  char clearRefsPath[64];
+  ::snprintf(clearRefsPath, sizeof(clearRefsPath), "/proc/%u/clear_refs", m_state.pid);
+  const int fd = ::open(clearRefsPath, O_WRONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  ++m_syscalls;
+  const bool ok = ::write(fd, "4", 1) == 1;
+  ::close(fd);
+  return ok;
+}
+
+size_t WinRPM::read_batch_uncached(std::span<ReadRequest> requests)
+{
+  for (auto& request : requests)
+    request.ok = false;
+
+  if (!this->isOpen())
+    return 0;
+
+  size_t numOk = 0;
+  size_t idx = 0;
+
+  // Explanation:
+  //  process_vm_readv transfers the remote iovecs in order, and stops at the first one that points to an inaccessible
+  //  region. Since every request gets exactly one local and one remote iovec, the number of bytes read tells us which
+  //  requests have succeeded, and which one has failed. The failed one is retried with pread (/proc/<pid>/mem can read
+  //  pages that process_vm_readv can't, e.g. PROT_NONE ones), and the rest is resubmitted.
+  while (!m_state.noVmReadv && idx < requests.size() && this->isOpen()) {
+    iovec localIov[IOV_MAX];
+    iovec remoteIov[IOV_MAX];
+    const size_t count = std::min<size_t>(requests.size() - idx, IOV_MAX);
+    for (size_t i = 0; i < count; ++i) {
+      const auto& request = requests[idx + i];
+      localIov[i] = {request.dataOut, request.dataSize};
+      remoteIov[i] = {(void*)request.remoteAddr, request.dataSize};
+    }
+
+    ++m_syscalls;
+    ssize_t bytes = ::process_vm_readv(m_state.pid, localIov, count, remoteIov, count, 0);
+
+    // Unlike /proc/<pid>/mem, process_vm_readv addresses the process by its pid, which could have been reused by
+    // another process if ours has exited in the meantime, so the results are only trusted if it's still alive after.
+    if (m_state.pidfd >= 0 && !this->pollIsOpen())
+      return numOk;
+
+    if (bytes == -1) {
+      // The process is gone
+      if (errno == ESRCH) {
+        this->close();
+        return numOk;
+      }
+
+      // Either the kernel doesn't support it, or we are not allowed to use it: fall back to pread
+      if (errno == ENOSYS || errno == EPERM) {
+        m_state.noVmReadv = true;
+        break;
+      }
+
+      // Otherwise the very first request was inaccessible
+      bytes = 0;
+    }
+
+    size_t i = 0;
+    for (; i < count && (size_t)bytes >= requests[idx + i].dataSize; ++i) {
+      bytes -= requests[idx + i].dataSize;
+      requests[idx + i].ok = true;
+      this->markTouched(requests[idx + i].remoteAddr, requests[idx + i].dataSize);
+      ++numOk;
+    }
+    if (i < count) {
+      auto& request = requests[idx + i];
+      if ((request.ok = this->read_raw_uncached(request.remoteAddr, request.dataOut, request.dataSize)))
+        ++numOk;
+    }
+    idx += (i < count) ? i + 1 : count;
+  }
+
+  // Fallback
+  for (; idx < requests.size() && this->isOpen(); ++idx) {
+    auto& request = requests[idx];
+    if ((request.ok = this->read_raw_uncached(request.remoteAddr, request.dataOut, request.dataSize)))
+      ++numOk;
+  }
+
+  return numOk;
+}
+
+size_t WinRPM::write_batch_uncached(std::span<WriteRequest> requests)
+{
+  for (auto& request : requests)
+    request.ok = false;
+
+  if (!this->isOpen())
+    return 0;
+
+  size_t numOk = 0;
+  size_t idx = 0;
+
+  // Same as read_batch_uncached, but process_vm_writev respects the page protections (unlike /proc/<pid>/mem), so the
+  // failed request is retried with pwrite.
+  while (!m_state.noVmWritev && idx < requests.size() && this->isOpen()) {
+    iovec localIov[IOV_MAX];
+    iovec remoteIov[IOV_MAX];
+    const size_t count = std::min<size_t>(requests.size() - idx, IOV_MAX);
+    for (size_t i = 0; i < count; ++i) {
+      const auto& request = requests[idx + i];
+      localIov[i] = {(void*)request.dataIn, request.dataSize};
+      remoteIov[i] = {(void*)request.remoteAddr, request.dataSize};
+    }
+
+    // Make sure that the pid still belongs to our process (see: the comment in read_batch_uncached)
+    if (m_state.pidfd >= 0 && !this->pollIsOpen())
+      return numOk;
+
+    ++m_syscalls;
+    ssize_t bytes = ::process_vm_writev(m_state.pid, localIov, count, remoteIov, count, 0);
+    if (bytes == -1) {
+      // The process is gone
+      if (errno == ESRCH) {
+        this->close();
+        return numOk;
+      }
+
+      // Either the kernel doesn't support it, or we are not allowed to use it: fall back to pwrite
+      if (errno == ENOSYS || errno == EPERM) {
+        m_state.noVmWritev = true;
+        break;
+      }
+
+      // Otherwise the very first request was inaccessible
+      bytes = 0;
+    }
+
+    size_t i = 0;
+    for (; i < count && (size_t)bytes >= requests[idx + i].dataSize; ++i) {
+      bytes -= requests[idx + i].dataSize;
+      requests[idx + i].ok = true;
+      this->markTouched(requests[idx + i].remoteAddr, requests[idx + i].dataSize);
+      ++numOk;
+    }
+    if (i < count) {
+      auto& request = requests[idx + i];
+      if ((request.ok = this->write_raw_uncached(request.remoteAddr, request.dataIn, request.dataSize)))
+        ++numOk;
+    }
+    idx += (i < count) ? i + 1 : count;
+  }
+
+  // Fallback
+  for (; idx < requests.size() && this->isOpen(); ++idx) {
+    auto& request = requests[idx];
+    if ((request.ok = this->write_raw_uncached(request.remoteAddr, request.dataIn, request.dataSize)))
+      ++numOk;
+  }
+
+  return numOk;
+}
+
+bool WinRPM::async_setup()
+{
+  io_uring_params params{};
+  const int ringFd = (int)::syscall(__NR_io_uring_setup, ASYNC_QUEUE_DEPTH, &params);
+  if (ringFd < 0)
+    return false;
+
+  auto& q = m_async;
+  q.ringFd = ringFd;
+
+  // IORING_OP_READ and IORING_OP_WRITE need Linux 5.6 (so does the probe itself)
+  {
+    constexpr unsigned numOps = IORING_OP_WRITE + 1;
+    alignas(io_uring_probe) unsigned char probeBuffer[sizeof(io_uring_probe) + numOps * sizeof(io_uring_probe_op)]{};
+    const auto probe = (io_uring_probe*)probeBuffer;
+    if (::syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, numOps) < 0 ||
+        probe->last_op < IORING_OP_WRITE || !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) ||
+        !(probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED)) {
+      this->async_teardown();
+      return false;
+    }
+  }
+
+  // Map the rings
+  const auto map = [&](size_t size, off_t offset) -> void* {
+    void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+  };
+
+  q.sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  q.cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMmap)
+    q.sqRingSize = q.cqRingSize = std::max(q.sqRingSize, q.cqRingSize);
+  q.sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+  if (!(q.sqRing = map(q.sqRingSize, IORING_OFF_SQ_RING)) ||
+      !(q.cqRing = singleMmap ? q.sqRing : map(q.cqRingSize, IORING_OFF_CQ_RING)) ||
+      !(q.sqes = map(q.sqesSize, IORING_OFF_SQES))) {
+    this->async_teardown();
+    return false;
+  }
+
+  const auto sqRing = (unsigned char*)q.sqRing;
+  q.sqHead = (unsigned*)(sqRing + params.sq_off.head);
+  q.sqTail = (unsigned*)(sqRing + params.sq_off.tail);
+  q.sqArray = (unsigned*)(sqRing + params.sq_off.array);
+  q.sqMask = *(unsigned*)(sqRing + params.sq_off.ring_mask);
+  q.sqEntries = params.sq_entries;
+
+  const auto cqRing = (unsigned char*)q.cqRing;
+  q.cqHead = (unsigned*)(cqRing + params.cq_off.head);
+  q.cqTail = (unsigned*)(cqRing + params.cq_off.tail);
+  q.cqes = cqRing + params.cq_off.cqes;
+  q.cqMask = *(unsigned*)(cqRing + params.cq_off.ring_mask);
+
+  return true;
+}
+
+void WinRPM::async_teardown()
+{
+  auto& q = m_async;
+  if (q.sqes)
+    ::munmap(q.sqes, q.sqesSize);
+  if (q.cqRing && q.cqRing != q.sqRing)
+    ::munmap(q.cqRing, q.cqRingSize);
+  if (q.sqRing)
+    ::munmap(q.sqRing, q.sqRingSize);
+  if (q.ringFd >= 0)
+    ::close(q.ringFd);
+  q = {};
+}
+
+size_t WinRPM::async_enter(unsigned minComplete)
+{
+  auto& q = m_async;
+
+  while (q.queued || minComplete) {
+    const rpm_stats::CallTimer timer(m_syscalls);
+    ++m_syscalls;
+    const long submitted = ::syscall(
+      __NR_io_uring_enter, q.ringFd, q.queued, minComplete, minComplete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0
+    );
+    timer.finish(rpm_stats::OP_ASYNC, 0, 0, 0, m_syscalls);
+    if (submitted >= 0) {
+      q.queued -= (unsigned)submitted;
+      break;
+    }
+    if (errno == EINTR)
+      continue;
+    if (errno == EAGAIN || errno == EBUSY)
+      break; // Reap what we have, the caller will try again
+
+    // Something went wrong: carry out the requests that the kernel hasn't consumed yet synchronously, and don't use
+    // io_uring anymore.
+    q.unavailable = true;
+    const unsigned head = std::atomic_ref(*q.sqHead).load(std::memory_order_acquire);
+    for (unsigned i = head; i != *q.sqTail; ++i) {
+      const auto& sqe = ((const io_uring_sqe*)q.sqes)[q.sqArray[i & q.sqMask]];
+      this->async_completeSync(*(AsyncRequest*)sqe.user_data);
+      --q.inflight;
+    }
+    std::atomic_ref(*q.sqTail).store(head, std::memory_order_release);
+    q.queued = 0;
+    break;
+  }
+
+  // Reap the completions
+  size_t reaped = 0;
+  unsigned head = *q.cqHead;
+  const unsigned tail = std::atomic_ref(*q.cqTail).load(std::memory_order_acquire);
+  for (; head != tail; ++head, ++reaped) {
+    const auto& cqe = ((const io_uring_cqe*)q.cqes)[head & q.cqMask];
+    auto& request = *(AsyncRequest*)cqe.user_data;
+    request.ok = cqe.res >= 0 && (size_t)cqe.res == request.dataSize;
+    request.done = true;
+    rpm_stats::record(rpm_stats::OP_ASYNC, 1, request.ok ? request.dataSize : 0, !request.ok, 0, -1);
+    if (request.ok)
+      this->markTouched(request.remoteAddr, request.dataSize);
+    if (m_trace) [[unlikely]]
+      this->trace_record(request.write, request.remoteAddr, request.data, request.dataSize, request.ok);
+  }
+  std::atomic_ref(*q.cqHead).store(head, std::memory_order_release);
+  q.inflight -= (unsigned)reaped;
+  q.completed += reaped;
+  return reaped;
+}
+
+void WinRPM::async_submit(AsyncRequest& request)
+{
+  request.done = request.ok = false;
+  ++m_async.pending;
+
+  if (request.write)
+    this->pageCache_update(request.remoteAddr, nullptr, request.dataSize);
+
+  // Set up io_uring on first use
+  auto& q = m_async;
+  if (q.ringFd < 0 && !q.unavailable && this->isOpen())
+    q.unavailable = !this->async_setup();
+
+  if (q.ringFd < 0 || q.unavailable || request.dataSize > UINT32_MAX) {
+    this->async_completeSync(request);
+    return;
+  }
+
+  // Make room: the number of requests in the ring never exceeds the size of the submission queue, so the completion
+  // queue (which is twice as big) can't overflow.
+  while (q.inflight >= q.sqEntries) {
+    if (!this->async_enter(1) && q.unavailable) {
+      this->async_completeSync(request);
+      return;
+    }
+  }
+
+  const unsigned tail = *q.sqTail;
+  const unsigned idx = tail & q.sqMask;
+  auto& sqe = ((io_uring_sqe*)q.sqes)[idx];
+  sqe = {};
+  sqe.opcode = request.write ? IORING_OP_WRITE : IORING_OP_READ;
+  sqe.fd = m_state.handle;
+  sqe.off = request.remoteAddr;
+  sqe.addr = (uintptr_t)request.data;
+  sqe.len = (uint32_t)request.dataSize;
+  sqe.user_data = (uintptr_t)&request;
+  q.sqArray[idx] = idx;
+  std::atomic_ref(*q.sqTail).store(tail + 1, std::memory_order_release);
+  ++q.queued;
+  ++q.inflight;
+}
+
+size_t WinRPM::async_reap(bool wait)
+{
+  if (m_async.ringFd >= 0) {
+    this->async_enter(0);
+    while (wait && m_async.inflight) {
+      if (!this->async_enter(1) && m_async.unavailable)
+        break;
+    }
+  }
+
+  const size_t reaped = std::exchange(m_async.completed, 0);
+  m_async.pending -= reaped;
+  return reaped;
 }
 
 #elif _WIN32
 
-PID WinRPM::getPIDByFilename(PathViewType processFilename)
+PID WinRPM::getPIDByFilename(PathViewType processFilename, ProcessDiscovery& discovery)
 {
   // Create snapshot
   HANDLE snapshot = ::CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
@@ -268,7 +880,8 @@ WinRPM::OpenResult WinRPM::open(PID pid)
   this->close();
 
   // Open new
-  m_state.handle = ::OpenProcess(PROCESS_VM_READ | PROCESS_VM_WRITE | PROCESS_QUERY_INFORMATION, false, pid);
+  m_state.handle =
+    ::OpenProcess(PROCESS_VM_READ | PROCESS_VM_WRITE | PROCESS_QUERY_INFORMATION | SYNCHRONIZE, false, pid);
   if (!m_state.handle)
     return ::GetLastError() == ERROR_ACCESS_DENIED ? WinRPM::OpenResult::NoPrivileges : WinRPM::OpenResult::Error;
   m_state.pid = pid;
@@ -345,49 +958,60 @@ static std::filesystem::path devicePathToDosPath(std::wstring_view path)
   return path;
 }
 
-WinRPM::MappedFileInfo WinRPM::getMappedFileInfo(PathViewType filename)
+bool WinRPM::queryRegions(RegionIndex& index)
 {
+  index.clear();
   if (!this->isOpen())
-    return {};
+    return false;
 
   MEMORY_BASIC_INFORMATION mbi;
   for (LPVOID address = g_systemInfo.lpMinimumApplicationAddress; address < g_systemInfo.lpMaximumApplicationAddress;
        address = (LPVOID)((uintptr_t)address + mbi.RegionSize)) {
     // Query info about the memory region
     if (!::VirtualQueryEx(m_state.handle, address, &mbi, sizeof(mbi))) {
-      this->pollIsOpen();
+      if (!this->pollIsOpen())
+        return false;
       break;
     }
 
-    // Look for mapped regions backed by a file
-    if (mbi.Type == MEM_MAPPED && mbi.State == MEM_COMMIT) {
-      wchar_t pathBuffer[MAX_PATH];
-      const auto pathLength = ::GetMappedFileNameW(m_state.handle, address, pathBuffer, MAX_PATH);
-      if (!pathLength)
-        continue;
-
-      std::wstring_view path{pathBuffer, pathLength};
-
-      // Fast fail (because device paths can only shrink)
-      if (path.size() < filename.size())
-        continue;
+    if (mbi.State != MEM_COMMIT)
+      continue;
 
-      // Check for a filename match (might be slightly faster than creating an std::filesystem::path every time)
-      const auto slashPos = path.rfind(L'\\');
-      if (!path.compare(slashPos == path.npos ? 0 : slashPos + 1, path.npos, filename)) {
-        return {
-          {(uintptr_t)mbi.BaseAddress, (uintptr_t)mbi.BaseAddress + (uintptr_t)mbi.RegionSize},
-          devicePathToDosPath(path)
-        };
-      }
+    // Translate the protection flags
+    uint8_t perms = 0;
+    if (!(mbi.Protect & (PAGE_NOACCESS | PAGE_GUARD))) {
+      constexpr DWORD readable = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READ |
+                                 PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+      constexpr DWORD writable = PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+      constexpr DWORD executable = PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+      perms |= (mbi.Protect & readable) ? RegionIndex::PERM_READ : 0;
+      perms |= (mbi.Protect & writable) ? RegionIndex::PERM_WRITE : 0;
+      perms |= (mbi.Protect & executable) ? RegionIndex::PERM_EXEC : 0;
     }
+    if (mbi.Type == MEM_MAPPED)
+      perms |= RegionIndex::PERM_SHARED;
+
+    // Only mapped regions are backed by files
+    wchar_t pathBuffer[MAX_PATH];
+    DWORD pathLength = 0;
+    if (mbi.Type == MEM_MAPPED || mbi.Type == MEM_IMAGE)
+      pathLength = ::GetMappedFileNameW(m_state.handle, address, pathBuffer, MAX_PATH);
+
+    const uintptr_t start = (uintptr_t)mbi.BaseAddress;
+    index.add(
+      {start, start + (uintptr_t)mbi.RegionSize}, perms, start - (uintptr_t)mbi.AllocationBase,
+      std::wstring_view{pathBuffer, pathLength}
+    );
   }
 
-  return {};
+  return true;
 }
 
 void WinRPM::close()
 {
+  this->async_reap();
+  this->stopTrace();
+  this->invalidate();
   if (!this->isOpen())
     return;
   ::CloseHandle(m_state.handle);
@@ -404,28 +1028,498 @@ bool WinRPM::pollIsOpen()
   return this->isOpen();
 }
 
-bool WinRPM::read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
+bool WinRPM::read_raw_uncached(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
 {
   if (!this->isOpen())
     return false;
+  ++m_syscalls;
   if (!::ReadProcessMemory(m_state.handle, (LPCVOID)remoteAddr, dataOut, dataSize, NULL)) {
     // Almost everything will throw an ERROR_PARTIAL_COPY
     this->pollIsOpen();
     return false;
   }
+  this->markTouched(remoteAddr, dataSize);
   return true;
 }
 
-bool WinRPM::write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize)
+bool WinRPM::write_raw_uncached(uintptr_t remoteAddr, const void* dataIn, size_t dataSize)
 {
   if (!this->isOpen())
     return false;
+  ++m_syscalls;
   if (!::WriteProcessMemory(m_state.handle, (LPVOID)remoteAddr, dataIn, dataSize, NULL)) {
     // Almost everything will throw an ERROR_PARTIAL_COPY
     this->pollIsOpen();
     return false;
   }
+  this->markTouched(remoteAddr, dataSize);
   return true;
 }
 
-#endif
\ No newline at end of file
+bool WinRPM::read_raw_threadsafe(uintptr_t remoteAddr, void* dataOut, size_t dataSize) const
+{
+  return ::ReadProcessMemory(m_state.handle, (LPCVOID)remoteAddr, dataOut, dataSize, NULL);
+}
+
+bool WinRPM::queryPageResidency(uintptr_t remoteAddr, size_t dataSize, PageResidency& residency)
+{
+  // QueryWorkingSetEx could tell which pages are in the working set, but not which ones have been paged out, so every
+  // page is considered worth reading.
+  residency = {};
+  return false;
+}
+
+bool WinRPM::clearSoftDirty()
+{
+  // There are no soft-dirty bits on Windows (GetWriteWatch only works on the process' own memory)
+  return false;
+}
+
+size_t WinRPM::read_batch_uncached(std::span<ReadRequest> requests)
+{
+  // There is no vectored ReadProcessMemory, so just read them one by one
+  size_t numOk = 0;
+  for (auto& request : requests) {
+    if ((request.ok = this->read_raw_uncached(request.remoteAddr, request.dataOut, request.dataSize)))
+      ++numOk;
+  }
+  return numOk;
+}
+
+size_t WinRPM::write_batch_uncached(std::span<WriteRequest> requests)
+{
+  // There is no vectored WriteProcessMemory either
+  size_t numOk = 0;
+  for (auto& request : requests) {
+    if ((request.ok = this->write_raw_uncached(request.remoteAddr, request.dataIn, request.dataSize)))
+      ++numOk;
+  }
+  return numOk;
+}
+
+void WinRPM::async_submit(AsyncRequest& request)
+{
+  // No overlapped IO for ReadProcessMemory, just carry it out right away
+  ++m_async.pending;
+  if (request.write)
+    this->pageCache_update(request.remoteAddr, nullptr, request.dataSize);
+  this->async_completeSync(request);
+}
+
+size_t WinRPM::async_reap(bool wait)
+{
+  const size_t reaped = std::exchange(m_async.completed, 0);
+  m_async.pending -= reaped;
+  return reaped;
+}
+
+#endif
+
+void WinRPM::async_completeSync(AsyncRequest& request)
+{
+  request.ok = request.write ? this->write_raw_uncached(request.remoteAddr, request.data, request.dataSize)
+                             : this->read_raw_uncached(request.remoteAddr, request.data, request.dataSize);
+  request.done = true;
+  ++m_async.completed;
+  rpm_stats::record(rpm_stats::OP_ASYNC, 1, request.ok ? request.dataSize : 0, !request.ok, 1, -1);
+  if (m_trace) [[unlikely]]
+    this->trace_record(request.write, request.remoteAddr, request.data, request.dataSize, request.ok);
+}
+
+// -------------------------------------------------------------------
+// - Mapped files
+// -------------------------------------------------------------------
+
+WinRPM::MappedFileInfo WinRPM::getMappedFileInfo(PathViewType filename)
+{
+  return std::move(this->getMappedFileInfos({&filename, 1})[0]);
+}
+
+std::vector<WinRPM::MappedFileInfo> WinRPM::getMappedFileInfos(std::span<const PathViewType> filenames)
+{
+  RegionIndex index;
+  if (!this->queryRegions(index))
+    return std::vector<MappedFileInfo>(filenames.size());
+  return WinRPM::findMappedFiles(index, filenames);
+}
+
+std::vector<WinRPM::MappedFileInfo> WinRPM::findMappedFiles(
+  const RegionIndex& index, std::span<const PathViewType> filenames
+)
+{
+  std::vector<MappedFileInfo> infos(filenames.size());
+
+#if __linux__
+  constexpr auto separator = '/';
+#elif _WIN32
+  constexpr auto separator = L'\\';
+#endif
+
+  size_t remaining = filenames.size();
+  for (const auto& region : index.regions()) {
+    // We are looking for the base addresses
+    if (region.fileOffset != 0 || !region.pathSize)
+      continue;
+
+    // Check for a filename match (might be slightly faster than creating an std::filesystem::path every time)
+    const auto path = index.path(region);
+    const auto slashPos = path.rfind(separator);
+    const auto regionFilename = path.substr(slashPos == path.npos ? 0 : slashPos + 1);
+    for (size_t i = 0; i < filenames.size(); ++i) {
+      if (infos[i].range || regionFilename != filenames[i])
+        continue;
+
+#if __linux__
+      infos[i] = {region.range, path};
+#elif _WIN32
+      infos[i] = {region.range, devicePathToDosPath(path)};
+#endif
+      if (--remaining == 0)
+        return infos;
+    }
+  }
+
+  return infos;
+}
+
+// -------------------------------------------------------------------
+// - Region index
+// -------------------------------------------------------------------
+
+void RegionIndex::add(MemRange range, uint8_t perms, uint64_t fileOffset, PathViewType path)
+{
+  m_starts.push_back(range.start);
+  m_regions.push_back({range, fileOffset, (uint32_t)m_pathPool.size(), (uint32_t)path.size(), perms});
+  m_pathPool.append(path);
+}
+
+bool RegionIndex::hasPerms(uintptr_t addr, size_t size, uint8_t perms) const
+{
+  for (const uintptr_t end = addr + size; addr < end;) {
+    const Region* region = this->find(addr);
+    if (!region || (region->perms & perms) != perms)
+      return false;
+    addr = region->range.end;
+  }
+  return true;
+}
+
+// -------------------------------------------------------------------
+// - Page cache
+// -------------------------------------------------------------------
+
+void WinRPM::enablePageCache(size_t maxPages)
+{
+  if (!maxPages) {
+    m_pageCache.reset();
+    return;
+  }
+
+  if (!m_pageCache)
+    m_pageCache = std::make_unique<PageCache>();
+  m_pageCache->maxPages = maxPages;
+
+  // Shrink if needed
+  while (m_pageCache->lru.size() > maxPages) {
+    m_pageCache->pages.erase(m_pageCache->lru.back().addr);
+    m_pageCache->lru.pop_back();
+  }
+}
+
+void WinRPM::beginEpoch()
+{
+  // Pages of older epochs are not dropped here, they will be reused lazily
+  if (m_pageCache)
+    ++m_pageCache->epoch;
+}
+
+void WinRPM::invalidate()
+{
+  if (!m_pageCache)
+    return;
+  m_pageCache->lru.clear();
+  m_pageCache->pages.clear();
+}
+
+const unsigned char* WinRPM::pageCache_get(uintptr_t pageAddr)
+{
+  auto& cache = *m_pageCache;
+
+  // Hit
+  auto it = cache.pages.find(pageAddr);
+  if (it != cache.pages.end() && it->second->epoch == cache.epoch) {
+    ++cache.stats.hits;
+    cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+    return it->second->data.data();
+  }
+
+  // Miss: reuse either the stale version of the page, the least recently used page, or allocate a new one
+  ++cache.stats.misses;
+  if (it == cache.pages.end()) {
+    if (cache.lru.size() >= cache.maxPages) {
+      cache.pages.erase(cache.lru.back().addr);
+      cache.lru.splice(cache.lru.begin(), cache.lru, std::prev(cache.lru.end()));
+    } else {
+      cache.lru.emplace_front();
+    }
+    it = cache.pages.emplace(pageAddr, cache.lru.begin()).first;
+  } else {
+    cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+  }
+
+  auto& page = *it->second;
+  page.addr = pageAddr;
+  page.epoch = cache.epoch;
+  if (!this->read_raw_uncached(pageAddr, page.data.data(), page.data.size())) {
+    // Reading might have closed the process (and thus cleared the cache)
+    if (this->isOpen()) {
+      cache.lru.erase(it->second);
+      cache.pages.erase(it);
+    }
+    return nullptr;
+  }
+  return page.data.data();
+}
+
+bool WinRPM::pageCache_read(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
+{
+  if (!m_pageCache || !dataSize)
+    return this->read_raw_uncached(remoteAddr, dataOut, dataSize);
+
+  if (dataSize > PAGE_CACHE_MAX_READ_SIZE) {
+    ++m_pageCache->stats.bypasses;
+    return this->read_raw_uncached(remoteAddr, dataOut, dataSize);
+  }
+
+  // Assemble the data from the cached pages
+  auto out = (unsigned char*)dataOut;
+  for (uintptr_t addr = remoteAddr, end = remoteAddr + dataSize; addr < end;) {
+    const uintptr_t pageAddr = addr & ~(PAGE_CACHE_PAGE_SIZE - 1);
+    const size_t size = std::min<uintptr_t>(end, pageAddr + PAGE_CACHE_PAGE_SIZE) - addr;
+
+    const auto page = this->pageCache_get(pageAddr);
+    if (!page)
+      return false;
+    ::memcpy(out, page + (addr - pageAddr), size);
+
+    out += size;
+    addr += size;
+  }
+  return true;
+}
+
+void WinRPM::pageCache_update(uintptr_t remoteAddr, const void* dataIn, size_t dataSize)
+{
+  if (!m_pageCache)
+    return;
+
+  auto& cache = *m_pageCache;
+  auto in = (const unsigned char*)dataIn;
+  for (uintptr_t addr = remoteAddr, end = remoteAddr + dataSize; addr < end;) {
+    const uintptr_t pageAddr = addr & ~(PAGE_CACHE_PAGE_SIZE - 1);
+    const size_t size = std::min<uintptr_t>(end, pageAddr + PAGE_CACHE_PAGE_SIZE) - addr;
+
+    if (const auto it = cache.pages.find(pageAddr); it != cache.pages.end()) {
+      if (in) {
+        ::memcpy(it->second->data.data() + (addr - pageAddr), in, size);
+      } else {
+        cache.lru.erase(it->second);
+        cache.pages.erase(it);
+      }
+    }
+
+    if (in)
+      in += size;
+    addr += size;
+  }
+}
+
+bool WinRPM::read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
+{
+  const rpm_stats::CallTimer timer(m_syscalls);
+  const bool ok = this->pageCache_read(remoteAddr, dataOut, dataSize);
+  timer.finish(rpm_stats::OP_READ, 1, ok ? dataSize : 0, !ok, m_syscalls);
+  if (m_trace) [[unlikely]]
+    this->trace_record(false, remoteAddr, dataOut, dataSize, ok);
+  return ok;
+}
+
+bool WinRPM::write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize)
+{
+  // Write through: update the cached pages, or drop them if we don't know what has been written
+  const rpm_stats::CallTimer timer(m_syscalls);
+  const bool ok = this->write_raw_uncached(remoteAddr, dataIn, dataSize);
+  this->pageCache_update(remoteAddr, ok ? dataIn : nullptr, dataSize);
+  timer.finish(rpm_stats::OP_WRITE, 1, ok ? dataSize : 0, !ok, m_syscalls);
+  if (m_trace) [[unlikely]]
+    this->trace_record(true, remoteAddr, dataIn, dataSize, ok);
+  return ok;
+}
+
+size_t WinRPM::read_batch(std::span<ReadRequest> requests)
+{
+  const rpm_stats::CallTimer timer(m_syscalls);
+  const size_t numOk = this->read_batch_uncached(requests);
+  if constexpr (rpm_stats::ENABLED) {
+    size_t bytes = 0;
+    for (const auto& request : requests)
+      bytes += request.ok ? request.dataSize : 0;
+    timer.finish(rpm_stats::OP_READ, requests.size(), bytes, requests.size() - numOk, m_syscalls);
+  }
+  if (m_trace) [[unlikely]] {
+    for (const auto& request : requests)
+      this->trace_record(false, request.remoteAddr, request.dataOut, request.dataSize, request.ok);
+  }
+  return numOk;
+}
+
+size_t WinRPM::write_batch(std::span<WriteRequest> requests)
+{
+  const rpm_stats::CallTimer timer(m_syscalls);
+  const size_t numOk = this->write_batch_uncached(requests);
+  for (const auto& request : requests)
+    this->pageCache_update(request.remoteAddr, request.ok ? request.dataIn : nullptr, request.dataSize);
+  if constexpr (rpm_stats::ENABLED) {
+    size_t bytes = 0;
+    for (const auto& request : requests)
+      bytes += request.ok ? request.dataSize : 0;
+    timer.finish(rpm_stats::OP_WRITE, requests.size(), bytes, requests.size() - numOk, m_syscalls);
+  }
+  if (m_trace) [[unlikely]] {
+    for (const auto& request : requests)
+      this->trace_record(true, request.remoteAddr, request.dataIn, request.dataSize, request.ok);
+  }
+  return numOk;
+}
+
+CompareWriteResult WinRPM::compare_and_write(
+  std::span<const CompareRequest> checks, uintptr_t remoteAddr, const void* dataIn, size_t dataSize
+)
+{
+  CompareWriteRequest request{checks, remoteAddr, dataIn, dataSize};
+  this->compare_and_write_batch({&request, 1});
+  return request.result;
+}
+
+size_t WinRPM::compare_and_write_batch(std::span<CompareWriteRequest> requests)
+{
+  // Set everything up front, so that nothing but the comparisons happen between the reads and the writes
+  size_t checksSize = 0;
+  size_t numChecks = 0;
+  for (const auto& request : requests) {
+    numChecks += request.checks.size();
+    for (const auto& check : request.checks)
+      checksSize += check.dataSize;
+  }
+  std::vector<unsigned char> buffer(checksSize);
+  std::vector<ReadRequest> readRequests;
+  readRequests.reserve(numChecks);
+  for (size_t offset = 0; const auto& request : requests) {
+    for (const auto& check : request.checks) {
+      readRequests.push_back({check.remoteAddr, &buffer[offset], check.dataSize});
+      offset += check.dataSize;
+    }
+  }
+  std::vector<WriteRequest> writeRequests;
+  writeRequests.reserve(requests.size());
+
+  this->read_batch(readRequests);
+  for (size_t checkIdx = 0; auto& request : requests) {
+    request.result = CompareWriteResult::Written;
+    for (const auto& check : request.checks) {
+      const auto& readRequest = readRequests[checkIdx++];
+      if (!readRequest.ok)
+        request.result = CompareWriteResult::Error;
+      else if (request.result == CompareWriteResult::Written &&
+               ::memcmp(readRequest.dataOut, check.expected, check.dataSize) != 0)
+        request.result = CompareWriteResult::Mismatch;
+    }
+    if (request.result == CompareWriteResult::Written)
+      writeRequests.push_back({request.remoteAddr, request.dataIn, request.dataSize});
+  }
+
+  this->write_batch(writeRequests);
+  size_t numWritten = 0;
+  for (size_t writeIdx = 0; auto& request : requests) {
+    if (request.result != CompareWriteResult::Written)
+      continue;
+    if (!writeRequests[writeIdx++].ok)
+      request.result = CompareWriteResult::Error;
+    else
+      ++numWritten;
+  }
+  return numWritten;
+}
+
+LargeReadResult WinRPM::read_large(
+  uintptr_t remoteAddr, void* dataOut, size_t dataSize, const PageResidency* residency, size_t chunkSize,
+  unsigned maxThreads
+)
+{
+  const rpm_stats::CallTimer timer(m_syscalls);
+  LargeReadResult result{remoteAddr, dataSize, chunkSize};
+  const size_t chunkCount = result.chunkCount();
+  if (!this->isOpen() || !chunkCount) {
+    ::memset(dataOut, 0, dataSize);
+    return result;
+  }
+
+  // The workers grab the chunks one by one, so a slow chunk doesn't hold the others up. They don't touch our state
+  // (the syscall counter, the touched pages, the trace), that is only updated once they are done.
+  std::vector<uint8_t> chunkOk(chunkCount);
+  std::vector<size_t> chunksToRead;
+  chunksToRead.reserve(chunkCount);
+  for (size_t idx = 0; idx < chunkCount; ++idx) {
+    const auto range = result.chunkRange(idx);
+    if (!residency || residency->isWorthReading(range.start, range.size())) {
+      chunksToRead.push_back(idx);
+    } else {
+      result.chunkSkipped[idx] = true;
+      ++result.numSkipped;
+      ::memset((unsigned char*)dataOut + (range.start - remoteAddr), 0, range.size());
+    }
+  }
+
+  std::atomic<size_t> nextChunk{0};
+  const auto worker = [&]() {
+    for (size_t i; (i = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunksToRead.size();) {
+      const size_t idx = chunksToRead[i];
+      const auto range = result.chunkRange(idx);
+      unsigned char* chunkOut = (unsigned char*)dataOut + (range.start - remoteAddr);
+      if (!(chunkOk[idx] = this->read_raw_threadsafe(range.start, chunkOut, range.size())))
+        ::memset(chunkOut, 0, range.size());
+    }
+  };
+
+  if (!maxThreads)
+    maxThreads = std::clamp(std::thread::hardware_concurrency(), 1u, LARGE_READ_MAX_THREADS);
+  const size_t numThreads = std::clamp<size_t>(chunksToRead.size(), 1, maxThreads);
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(numThreads - 1);
+    for (size_t i = 1; i < numThreads; ++i)
+      threads.emplace_back(worker);
+    worker();
+  }
+
+  m_syscalls += chunksToRead.size();
+  size_t bytesOk = 0;
+  for (const size_t idx : chunksToRead) {
+    const auto range = result.chunkRange(idx);
+    unsigned char* chunkOut = (unsigned char*)dataOut + (range.start - remoteAddr);
+    if ((result.chunkOk[idx] = chunkOk[idx])) {
+      ++result.numOk;
+      bytesOk += range.size();
+      this->markTouched(range.start, range.size());
+    }
+    if (m_trace) [[unlikely]]
+      this->trace_record(false, range.start, chunkOut, range.size(), chunkOk[idx]);
+  }
+
+  timer.finish(rpm_stats::OP_READ, 1, bytesOk, !result.ok(), m_syscalls);
+
+  // The chunks might have failed because the process is exiting
+  if (result.numFailed())
+    this->pollIsOpen();
+  return result;
+}
\ No newline at end of file
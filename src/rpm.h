@@ -1,8 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cinttypes>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <set>
+#include <span>
+#include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 // Forward declare some stuff
 #if __linux__
@@ -24,22 +36,527 @@ struct MemRange {
   inline constexpr bool in(uintptr_t addr) const { return start <= addr && addr < end; }
 };
 
+/**
+ * A sorted table of the memory regions of a remote process (see: WinRPM::queryRegions), which can tell whether an
+ * address is mapped without a syscall. It's only a snapshot, so it should be refreshed every now and then.
+ */
+class RegionIndex
+{
+public:
+  using PathViewType = std::basic_string_view<std::filesystem::path::value_type>;
+
+  enum Perms : uint8_t {
+    PERM_READ = 1u << 0,
+    PERM_WRITE = 1u << 1,
+    PERM_EXEC = 1u << 2,
+    PERM_SHARED = 1u << 3
+  };
+
+  struct Region {
+    MemRange range{};
+    uint64_t fileOffset{};
+    uint32_t pathOffset{}; // Into the path pool
+    uint32_t pathSize{};   // 0 for anonymous regions
+    uint8_t perms{};
+  };
+
+protected:
+  // The start addresses are kept apart from the rest, so that the binary search touches as few cache lines as possible
+  std::vector<uintptr_t> m_starts;
+  std::vector<Region> m_regions;
+  std::filesystem::path::string_type m_pathPool;
+
+public:
+  /**
+   * Removes every region.
+   */
+  void clear()
+  {
+    m_starts.clear();
+    m_regions.clear();
+    m_pathPool.clear();
+  }
+
+  /**
+   * Appends a region. The regions must be added in ascending order, and they must not overlap.
+   */
+  void add(MemRange range, uint8_t perms, uint64_t fileOffset = 0, PathViewType path = {});
+
+  inline bool empty() const { return m_regions.empty(); }
+  inline size_t size() const { return m_regions.size(); }
+  inline std::span<const Region> regions() const { return m_regions; }
+
+  /**
+   * Returns the path of the file backing the region (or an empty string for anonymous regions).
+   * On Windows, it's a device path (e.g. "\Device\HarddiskVolume1\...").
+   */
+  inline PathViewType path(const Region& region) const
+  {
+    return PathViewType{m_pathPool}.substr(region.pathOffset, region.pathSize);
+  }
+
+  /**
+   * Returns the region containing the address, or nullptr if the address isn't mapped.
+   */
+  inline const Region* find(uintptr_t addr) const
+  {
+    // The first region that starts after the address, the one before it is the only one that might contain it
+    const auto it = std::upper_bound(m_starts.begin(), m_starts.end(), addr);
+    if (it == m_starts.begin())
+      return nullptr;
+    const Region& region = m_regions[it - m_starts.begin() - 1];
+    return region.range.in(addr) ? &region : nullptr;
+  }
+
+  /**
+   * Returns whether the whole [addr, addr + size) range is mapped with (at least) the given permissions, possibly
+   * spanning adjacent regions.
+   */
+  bool hasPerms(uintptr_t addr, size_t size, uint8_t perms) const;
+  inline bool isReadable(uintptr_t addr, size_t size = 1) const { return this->hasPerms(addr, size, PERM_READ); }
+};
+
+/**
+ * The residency of the pages of a remote range (see: WinRPM::queryPageResidency).
+ */
+struct PageResidency {
+  static constexpr size_t PAGE_SIZE = 0x1000;
+
+  enum Flags : uint8_t {
+    PAGE_PRESENT = 1u << 0,    // In physical memory
+    PAGE_SWAPPED = 1u << 1,    // Swapped out
+    PAGE_FILE = 1u << 2,       // A page of a file (or shared anonymous memory), rather than a private anonymous one
+    PAGE_SOFT_DIRTY = 1u << 3, // Written since the soft-dirty bits were last cleared
+  };
+
+  uintptr_t firstPage = 0;
+  std::vector<uint8_t> pages; // Flags for each page
+
+  /**
+   * Returns whether any page overlapping with [addr, addr + size) holds data that the process has put there, i.e. it's
+   * either present, or swapped out. The rest of the pages have never been touched (or have been dropped, and would be
+   * read back from their file): reading them would only fault them in, which is both slow and inflates the RSS of the
+   * process. Pages outside of the queried range are assumed to be worth reading.
+   */
+  inline bool isWorthReading(uintptr_t addr, size_t size) const
+  {
+    if (!size)
+      return false;
+    const uintptr_t endPage = firstPage + pages.size() * PAGE_SIZE;
+    for (uintptr_t page = addr & ~(PAGE_SIZE - 1); page < addr + size; page += PAGE_SIZE) {
+      if (page < firstPage || page >= endPage)
+        return true;
+      if (pages[(page - firstPage) / PAGE_SIZE] & (PAGE_PRESENT | PAGE_SWAPPED))
+        return true;
+    }
+    return false;
+  }
+};
+
+/**
+ * The outcome of a large read (see: read_large). The range is split into chunks that are aligned to the chunk size in
+ * the remote address space (so the first and the last ones might be shorter), and each of them succeeds or fails on its
+ * own, or gets skipped (if it's not worth reading, see: PageResidency).
+ */
+struct LargeReadResult {
+  static constexpr size_t DEFAULT_CHUNK_SIZE = 0x10000;
+
+  uintptr_t remoteAddr = 0;
+  size_t dataSize = 0;
+  size_t chunkSize = DEFAULT_CHUNK_SIZE; // A power of two
+  std::vector<bool> chunkOk;
+  std::vector<bool> chunkSkipped;
+  size_t numOk = 0;
+  size_t numSkipped = 0;
+
+  LargeReadResult() noexcept = default;
+  LargeReadResult(uintptr_t remoteAddr, size_t dataSize, size_t chunkSize)
+    : remoteAddr(remoteAddr), dataSize(dataSize), chunkSize(chunkSize)
+  {
+    if (dataSize) {
+      chunkOk.resize(this->chunkIndex(remoteAddr + dataSize - 1) + 1);
+      chunkSkipped.resize(chunkOk.size());
+    }
+  }
+
+  /**
+   * Returns the number of chunks that were read, but have failed.
+   */
+  inline size_t numFailed() const { return chunkOk.size() - numOk - numSkipped; }
+
+  inline size_t chunkCount() const { return chunkOk.size(); }
+  inline size_t chunkIndex(uintptr_t addr) const
+  {
+    return ((addr & ~(chunkSize - 1)) - (remoteAddr & ~(chunkSize - 1))) / chunkSize;
+  }
+
+  /**
+   * Returns the remote range covered by the given chunk.
+   */
+  inline MemRange chunkRange(size_t idx) const
+  {
+    const uintptr_t start = (remoteAddr & ~(chunkSize - 1)) + idx * chunkSize;
+    return {std::max(start, remoteAddr), std::min(start + chunkSize, remoteAddr + dataSize)};
+  }
+
+  /**
+   * Returns whether the whole range has been read.
+   */
+  inline bool ok() const { return dataSize && numOk == chunkOk.size(); }
+
+  /**
+   * Returns whether the [addr, addr + size) part of the range has been read.
+   */
+  inline bool isOk(uintptr_t addr, size_t size) const
+  {
+    if (addr < remoteAddr || addr + size > remoteAddr + dataSize || !size)
+      return false;
+    for (size_t idx = this->chunkIndex(addr); idx <= this->chunkIndex(addr + size - 1); ++idx) {
+      if (!chunkOk[idx])
+        return false;
+    }
+    return true;
+  }
+};
+
+/**
+ * A check of compare_and_write: the remote [remoteAddr, remoteAddr + dataSize) range has to hold the expected bytes.
+ */
+struct CompareRequest {
+  uintptr_t remoteAddr{};
+  const void* expected{};
+  size_t dataSize{};
+};
+
+enum class CompareWriteResult {
+  Written,  // Every check has passed, and the data has been written
+  Mismatch, // Some check has failed, so nothing has been written
+  Error     // Some check couldn't be read, or the write has failed
+};
+
+/**
+ * A guarded write of compare_and_write_batch.
+ */
+struct CompareWriteRequest {
+  std::span<const CompareRequest> checks;
+  uintptr_t remoteAddr{};
+  const void* dataIn{};
+  size_t dataSize{};
+  CompareWriteResult result = CompareWriteResult::Error; // Set by compare_and_write_batch
+};
+
+/**
+ * The typed helpers shared by every remote memory access backend (see: rpm_backends.h). The backend (Derived) only
+ * has to implement read_raw and write_raw, and these get bound to them at compile time.
+ */
+template <typename Derived>
+class RPMInterface
+{
+public:
+  /**
+   * Reads an object of type T from the remote process' memory.
+   */
+  template <typename T>
+  inline bool read(uintptr_t remoteAddr, T& dataOut, size_t offset = 0)
+    requires(std::is_trivially_copyable_v<T>)
+  {
+    return static_cast<Derived*>(this)->read_raw(remoteAddr + offset, &dataOut, sizeof(T));
+  }
+
+  /**
+   * Reads an object of type T from the remote process' memory through a pointer chain.
+   * That is: *(*( ... *(*(remoteAddr + offset_1) + offset_2) ... ) + offset_n)
+   */
+  template <typename T, typename... OFFSETS>
+  inline bool read(uintptr_t remoteAddr, T& dataOut, size_t offset_1, size_t offset_2, OFFSETS... offset_n)
+    requires(std::is_trivially_copyable_v<T>)
+  {
+    // NOTE: sadly C++ as of C++20 doesn't have homogeneous function parameter packs :(
+    if (!this->read<uintptr_t>(remoteAddr, remoteAddr, offset_1))
+      return false;
+    return this->read<T>(remoteAddr, dataOut, offset_2, offset_n...);
+  }
+
+  /**
+   * Writes an object of type T the the remote process' memory.
+   */
+  template <typename T>
+  inline bool write(uintptr_t remoteAddr, const T& dataIn, size_t offset = 0)
+    requires(std::is_trivially_copyable_v<T>)
+  {
+    return static_cast<Derived*>(this)->write_raw(remoteAddr + offset, &dataIn, sizeof(T));
+  }
+
+  /**
+   * Writes an object of type T to the remote process' memory through a pointer chain.
+   * That is: *(*( ... *(*(remoteAddr + offset_1) + offset_2) ... ) + offset_n) = dataIn
+   */
+  template <typename T, typename... OFFSETS>
+  inline bool write(uintptr_t remoteAddr, const T& dataIn, size_t offset_1, size_t offset_2, OFFSETS... offset_n)
+    requires(std::is_trivially_copyable_v<T>)
+  {
+    if (!this->read<uintptr_t>(remoteAddr, remoteAddr, offset_1))
+      return false;
+    return this->write<T>(remoteAddr, dataIn, offset_2, offset_n...);
+  }
+
+  /**
+   * Writes [remoteAddr, remoteAddr + dataSize) only if every check passes (e.g. the object still has the same class and
+   * the field still holds the value it was read with), re-reading the checked ranges right before the write, so that
+   * the window between the check and the write is as short as possible.
+   * Note that it's not atomic: the remote process can still change the memory in between.
+   */
+  CompareWriteResult compare_and_write(
+    std::span<const CompareRequest> checks, uintptr_t remoteAddr, const void* dataIn, size_t dataSize
+  )
+  {
+    auto& self = static_cast<Derived&>(*this);
+    std::vector<unsigned char> buffer;
+    for (const auto& check : checks) {
+      buffer.resize(check.dataSize);
+      if (!self.read_raw(check.remoteAddr, buffer.data(), check.dataSize))
+        return CompareWriteResult::Error;
+      if (::memcmp(buffer.data(), check.expected, check.dataSize) != 0)
+        return CompareWriteResult::Mismatch;
+    }
+    return self.write_raw(remoteAddr, dataIn, dataSize) ? CompareWriteResult::Written : CompareWriteResult::Error;
+  }
+
+  /**
+   * Carries out multiple guarded writes (see: compare_and_write). Backends may check all of them first, and then write
+   * the ones that have passed together (see: WinRPM::compare_and_write_batch).
+   * Returns the number of writes that have happened.
+   */
+  size_t compare_and_write_batch(std::span<CompareWriteRequest> requests)
+  {
+    size_t numWritten = 0;
+    for (auto& request : requests) {
+      request.result = this->compare_and_write(request.checks, request.remoteAddr, request.dataIn, request.dataSize);
+      numWritten += request.result == CompareWriteResult::Written;
+    }
+    return numWritten;
+  }
+
+  /**
+   * Reads a large range of the remote process' memory chunk by chunk, so that an unreadable part only fails the chunks
+   * that overlap with it (these are zeroed out), rather than the whole read.
+   * If the residency of the range is given (see: queryPageResidency), then the chunks that aren't worth reading are
+   * skipped (and zeroed out) too.
+   * Backends may read the chunks in parallel (see: WinRPM::read_large).
+   */
+  LargeReadResult read_large(
+    uintptr_t remoteAddr, void* dataOut, size_t dataSize, const PageResidency* residency = nullptr,
+    size_t chunkSize = LargeReadResult::DEFAULT_CHUNK_SIZE
+  )
+  {
+    LargeReadResult result{remoteAddr, dataSize, chunkSize};
+    for (size_t idx = 0; idx < result.chunkCount(); ++idx) {
+      const auto range = result.chunkRange(idx);
+      unsigned char* chunkOut = (unsigned char*)dataOut + (range.start - remoteAddr);
+      if (residency && !residency->isWorthReading(range.start, range.size())) {
+        result.chunkSkipped[idx] = true;
+        ++result.numSkipped;
+        ::memset(chunkOut, 0, range.size());
+      } else if ((result.chunkOk[idx] = static_cast<Derived*>(this)->read_raw(range.start, chunkOut, range.size()))) {
+        ++result.numOk;
+      } else {
+        ::memset(chunkOut, 0, range.size());
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Queries the residency of the pages of the given remote range. Backends that can't tell return false.
+   */
+  inline bool queryPageResidency(uintptr_t, size_t, PageResidency& residency)
+  {
+    residency = {};
+    return false;
+  }
+
+  /**
+   * Clears the soft-dirty bits of the remote process (see: PageResidency::PAGE_SOFT_DIRTY). Backends that can't track
+   * the written pages return false.
+   */
+  inline bool clearSoftDirty() { return false; }
+};
+
 /**
  * A simplpe class to read a remote process' memory. It works on both native Windows and Wine.
  * It doesn't support Windows long paths.
  */
-class WinRPM
+class WinRPM : public RPMInterface<WinRPM>
 {
 protected:
   struct State {
     PID pid = 0;
 #if __linux__
     int handle = -1;
+    int pidfd = -1;         // Optional, might be -1 even if the process is open (Linux < 5.3)
+    bool noVmReadv = false;  // process_vm_readv is unavailable (e.g. denied by a seccomp filter)
+    bool noVmWritev = false; // process_vm_writev is unavailable
 #elif _WIN32
     HANDLE handle = 0;
 #endif
   } m_state;
 
+public:
+  static constexpr size_t PAGE_CACHE_PAGE_SIZE = 0x1000;
+  static constexpr size_t PAGE_CACHE_MAX_READ_SIZE = 4 * PAGE_CACHE_PAGE_SIZE; // Bigger reads bypass the cache
+
+  struct PageCacheStats {
+    uint64_t hits{};     // Pages served from the cache
+    uint64_t misses{};   // Pages read from the remote process (each one costs a syscall)
+    uint64_t bypasses{}; // Reads that were too big to go through the cache
+  };
+
+protected:
+  /**
+   * An LRU-bounded cache of remote pages (see: enablePageCache).
+   */
+  struct PageCache {
+    struct Page {
+      uintptr_t addr{};
+      uint64_t epoch{};
+      std::array<unsigned char, PAGE_CACHE_PAGE_SIZE> data;
+    };
+
+    std::list<Page> lru; // The most recently used page is at the front
+    std::unordered_map<uintptr_t, std::list<Page>::iterator> pages;
+    size_t maxPages{};
+    uint64_t epoch{};
+    PageCacheStats stats{};
+  };
+  std::unique_ptr<PageCache> m_pageCache;
+
+public:
+  struct AsyncRequest {
+    uintptr_t remoteAddr{};
+    void* data{}; // The destination of reads, or the source of writes
+    size_t dataSize{};
+    bool write = false;
+    bool done = false; // Set once the request has completed
+    bool ok = false;   // Set once the request has completed
+  };
+
+  static constexpr unsigned ASYNC_QUEUE_DEPTH = 256;
+
+protected:
+  /**
+   * The state of the asynchronous request queue. On Linux, it's an io_uring instance that is set up on first use.
+   */
+  struct AsyncQueue {
+#if __linux__
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    size_t sqRingSize = 0;
+    void* cqRing = nullptr;
+    size_t cqRingSize = 0;
+    void* sqes = nullptr;
+    size_t sqesSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    void* cqes = nullptr;
+    unsigned cqMask = 0;
+    unsigned queued = 0;   // Requests in the submission queue that haven't been handed to the kernel yet
+    unsigned inflight = 0; // Requests in the ring that haven't been reaped yet
+
+    // io_uring is either not supported by the kernel, or not permitted (e.g. kernel.io_uring_disabled)
+    bool unavailable = false;
+#endif
+    size_t pending = 0;   // Requests that haven't been reported as reaped yet
+    size_t completed = 0; // Requests that have completed, but haven't been reported as reaped by async_reap yet
+  } m_async;
+
+#if __linux__
+  /**
+   * Sets up / tears down the asynchronous request queue.
+   */
+  bool async_setup();
+  void async_teardown();
+
+  /**
+   * Hands the queued requests to the kernel, waits for at least minComplete completions, and reaps the completed
+   * requests. Returns the number of requests reaped by this call.
+   */
+  size_t async_enter(unsigned minComplete);
+#endif
+
+  /**
+   * Carries out an asynchronous request synchronously.
+   */
+  void async_completeSync(AsyncRequest& request);
+
+  /**
+   * Returns a pointer to the cached contents of the remote page at pageAddr, and reads it if needed.
+   * Returns a null pointer if the page is not readable.
+   */
+  const unsigned char* pageCache_get(uintptr_t pageAddr);
+
+  /**
+   * Updates the cached pages overlapping with the given remote range, or drops them if dataIn is a null pointer.
+   */
+  void pageCache_update(uintptr_t remoteAddr, const void* dataIn, size_t dataSize);
+
+  /**
+   * Reads / writes the remote process's memory directly, without going through the page cache.
+   */
+  bool read_raw_uncached(uintptr_t remoteAddr, void* dataOut, size_t dataSize);
+  bool write_raw_uncached(uintptr_t remoteAddr, const void* dataIn, size_t dataSize);
+
+  /**
+   * Reads the remote process's memory with a single syscall, without touching any of our state, so that it can be
+   * called from multiple threads at once (see: read_large).
+   */
+  bool read_raw_threadsafe(uintptr_t remoteAddr, void* dataOut, size_t dataSize) const;
+
+  /**
+   * Reads the remote process's memory through the page cache (if enabled).
+   */
+  bool pageCache_read(uintptr_t remoteAddr, void* dataOut, size_t dataSize);
+
+  /**
+   * The number of read / write syscalls issued so far (see: getSyscallCount).
+   */
+  uint64_t m_syscalls = 0;
+
+  /**
+   * The state of the transaction recorder (see: startTrace).
+   */
+  struct Trace {
+    std::ofstream os;
+    std::chrono::steady_clock::time_point start;
+    uint64_t lastSyscalls = 0;
+    uint64_t records = 0;
+  };
+  std::unique_ptr<Trace> m_trace;
+
+  /**
+   * Appends a completed transaction to the trace (see: rpm_trace.h). Defined in rpm_trace.cpp.
+   */
+  void trace_record(bool write, uintptr_t remoteAddr, const void* data, size_t dataSize, bool ok);
+
+  // The remote pages touched since trackTouchedPages(true), if enabled
+  std::unique_ptr<std::set<uintptr_t>> m_touchedPages;
+
+  /**
+   * Records the pages overlapping with the given remote range, if enabled (see: trackTouchedPages).
+   */
+  inline void markTouched(uintptr_t remoteAddr, size_t dataSize)
+  {
+    if (!m_touchedPages) [[likely]]
+      return;
+    for (uintptr_t page = remoteAddr & ~(PAGE_CACHE_PAGE_SIZE - 1); page < remoteAddr + dataSize;
+         page += PAGE_CACHE_PAGE_SIZE)
+      m_touchedPages->insert(page);
+  }
+
 public:
   /**
    * Note (rant):
@@ -64,11 +581,21 @@ public:
   WinRPM(const WinRPM&) = delete;
   WinRPM& operator=(const WinRPM&) = delete;
 
-  WinRPM(WinRPM&& rhs) noexcept : m_state(std::exchange(rhs.m_state, {})) {}
+  WinRPM(WinRPM&& rhs) noexcept
+    : m_state(std::exchange(rhs.m_state, {})), m_pageCache(std::move(rhs.m_pageCache)),
+      m_async(std::exchange(rhs.m_async, {})), m_syscalls(std::exchange(rhs.m_syscalls, 0)),
+      m_trace(std::move(rhs.m_trace)), m_touchedPages(std::move(rhs.m_touchedPages))
+  {
+  }
   WinRPM& operator=(WinRPM&& rhs)
   {
     this->close();
     m_state = std::exchange(rhs.m_state, {});
+    m_pageCache = std::move(rhs.m_pageCache);
+    m_async = std::exchange(rhs.m_async, {});
+    m_syscalls = std::exchange(rhs.m_syscalls, 0);
+    m_trace = std::move(rhs.m_trace);
+    m_touchedPages = std::move(rhs.m_touchedPages);
     return *this;
   }
 
@@ -79,11 +606,48 @@ public:
     Error
   };
 
+  /**
+   * Persistent state for getPIDByFilename, so that consecutive searches only have to examine the processes that have
+   * been started (or have exec'd) since the previous search.
+   */
+  struct ProcessDiscovery {
+    // If set, processes that belong to a different Steam app (based on their SteamAppId env var) are rejected early
+    std::string steamAppId;
+
+#if __linux__
+    struct Rejected {
+      unsigned long long startTime{}; // To tell apart reused PIDs
+      std::array<char, 16> comm{};    // To notice execs
+      uint64_t generation{};          // The last search that has seen the process
+    };
+    std::unordered_map<PID, Rejected> rejected{};
+    uint64_t generation{};
+#endif
+  };
+
   /**
    * Returns the PID of the first running process with a given filename.
    * If no such process can be found, 0 will be returned.
    */
-  static PID getPIDByFilename(PathViewType processFilename);
+  static PID getPIDByFilename(PathViewType processFilename)
+  {
+    ProcessDiscovery discovery;
+    return WinRPM::getPIDByFilename(processFilename, discovery);
+  }
+  static PID getPIDByFilename(PathViewType processFilename, ProcessDiscovery& discovery);
+
+#if __linux__
+  enum class ProcessMatch {
+    NoMatch, // Either not a Wine process, or a Wine process running a different executable
+    Pending, // A Wine process that hasn't finished starting up yet, so it's not known what it will be running
+    Match
+  };
+
+  /**
+   * Checks whether a process is a Wine process running an executable with the given filename.
+   */
+  static ProcessMatch matchProcess(PID pid, PathViewType processFilename);
+#endif
 
   /**
    * Opens a remote process based on its PID.
@@ -126,6 +690,23 @@ public:
    */
   MappedFileInfo getMappedFileInfo(PathViewType filename);
 
+  /**
+   * Same as getMappedFileInfo, but looks up any number of files in a single pass over the memory regions.
+   * The results are in the same order as the filenames.
+   */
+  std::vector<MappedFileInfo> getMappedFileInfos(std::span<const PathViewType> filenames);
+
+  /**
+   * Same as getMappedFileInfos, but it looks for the files in an already queried region index.
+   */
+  static std::vector<MappedFileInfo> findMappedFiles(const RegionIndex& index, std::span<const PathViewType> filenames);
+
+  /**
+   * Rebuilds the region index from the current memory regions of the remote process. It takes a single read of
+   * /proc/<pid>/maps on Linux, and a VirtualQueryEx walk on Windows.
+   */
+  bool queryRegions(RegionIndex& index);
+
   /**
    * Closes the handle to the process.
    */
@@ -146,65 +727,204 @@ public:
 
   inline PID getPID() const { return m_state.pid; }
 
+#if __linux__
+  using ExitWaitHandle = int;
+#elif _WIN32
+  using ExitWaitHandle = HANDLE;
+#endif
+
+  /**
+   * Returns a handle that becomes readable (Linux: pidfd) or signaled (Windows: process handle) once the process exits,
+   * so the caller can wait for it in an event loop. The handle is owned by WinRPM and is only valid while the process
+   * is open. On Linux < 5.3 (no pidfd support), it's -1.
+   */
+  inline ExitWaitHandle getExitWaitHandle() const
+  {
+#if __linux__
+    return m_state.pidfd;
+#elif _WIN32
+    return m_state.handle;
+#endif
+  }
+
   /**
-   * Polls the OS to see whether the handle is still valid.
+   * Polls the OS to see whether the handle is still valid (i.e. the process is still running), and closes it if not.
+   * On Linux, this is a non-blocking poll on the pidfd (if supported).
    */
   bool pollIsOpen();
 
   /**
-   * Reads the remote process's memory.
+   * Enables the page cache, which will hold at most maxPages remote pages. Small reads will be served from it, and
+   * writes will go through it. Since the remote process keeps on running, the cached pages only stay valid until the
+   * next beginEpoch (or invalidate) call. Passing 0 disables the cache.
    */
-  bool read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize);
+  void enablePageCache(size_t maxPages);
+  inline bool isPageCacheEnabled() const { return m_pageCache != nullptr; }
 
   /**
-   * Writes the remote process's memory.
+   * Starts a new cache epoch: pages cached before this call won't be served anymore. This way, everything read during
+   * an epoch comes from one consistent view, that is not older than the start of the epoch.
    */
-  bool write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize);
+  void beginEpoch();
 
   /**
-   * Reads an object of type T from the remote process' memory.
+   * Drops every cached page and frees up their memory.
    */
-  template <typename T>
-  inline bool read(uintptr_t remoteAddr, T& dataOut, size_t offset = 0)
-    requires(std::is_trivially_copyable_v<T>)
-  {
-    return this->read_raw(remoteAddr + offset, &dataOut, sizeof(T));
-  }
+  void invalidate();
 
   /**
-   * Reads an object of type T from the remote process' memory through a pointer chain.
-   * That is: *(*( ... *(*(remoteAddr + offset_1) + offset_2) ... ) + offset_n)
+   * Starts (or stops) recording which remote pages get read or written (see: snapshot.h). Starting it again clears the
+   * recorded pages.
    */
-  template <typename T, typename... OFFSETS>
-  inline bool read(uintptr_t remoteAddr, T& dataOut, size_t offset_1, size_t offset_2, OFFSETS... offset_n)
-    requires(std::is_trivially_copyable_v<T>)
+  inline void trackTouchedPages(bool enable)
   {
-    // NOTE: sadly C++ as of C++20 doesn't have homogeneous function parameter packs :(
-    if (!this->read<uintptr_t>(remoteAddr, remoteAddr, offset_1))
-      return false;
-    return this->read<T>(remoteAddr, dataOut, offset_2, offset_n...);
+    m_touchedPages = enable ? std::make_unique<std::set<uintptr_t>>() : nullptr;
   }
 
   /**
-   * Writes an object of type T the the remote process' memory.
+   * Returns the (page aligned) addresses of the pages recorded so far, in ascending order.
    */
-  template <typename T>
-  inline bool write(uintptr_t remoteAddr, const T& dataIn, size_t offset = 0)
-    requires(std::is_trivially_copyable_v<T>)
+  inline std::vector<uintptr_t> getTouchedPages() const
   {
-    return this->write_raw(remoteAddr + offset, &dataIn, sizeof(T));
+    return m_touchedPages ? std::vector<uintptr_t>(m_touchedPages->begin(), m_touchedPages->end())
+                          : std::vector<uintptr_t>{};
   }
 
   /**
-   * Writes an object of type T to the remote process' memory through a pointer chain.
-   * That is: *(*( ... *(*(remoteAddr + offset_1) + offset_2) ... ) + offset_n) = dataIn
+   * Starts recording every read and write (along with its outcome, the data transferred and the number of syscalls it
+   * took) into a binary trace file, which can be replayed later without the game (see: rpm_trace.h). The memory
+   * regions of the process are saved into the header. Starting it again restarts the trace.
+   * Returns false if the process isn't open or the file can't be created.
    */
-  template <typename T, typename... OFFSETS>
-  inline bool write(uintptr_t remoteAddr, const T& dataIn, size_t offset_1, size_t offset_2, OFFSETS... offset_n)
-    requires(std::is_trivially_copyable_v<T>)
+  bool startTrace(const std::filesystem::path& tracePath);
+
+  /**
+   * Stops recording and flushes the trace file.
+   */
+  void stopTrace();
+
+  /**
+   * Returns the number of read / write syscalls issued so far.
+   */
+  inline uint64_t getSyscallCount() const { return m_syscalls; }
+
+  inline PageCacheStats getPageCacheStats() const { return m_pageCache ? m_pageCache->stats : PageCacheStats{}; }
+  inline void resetPageCacheStats()
   {
-    if (!this->read<uintptr_t>(remoteAddr, remoteAddr, offset_1))
-      return false;
-    return this->write<T>(remoteAddr, dataIn, offset_2, offset_n...);
+    if (m_pageCache)
+      m_pageCache->stats = {};
   }
+
+  /**
+   * Reads the remote process's memory.
+   */
+  bool read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize);
+
+  /**
+   * Writes the remote process's memory.
+   */
+  bool write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize);
+
+  struct ReadRequest {
+    uintptr_t remoteAddr{};
+    void* dataOut{};
+    size_t dataSize{};
+    bool ok = false; // Set by read_batch
+  };
+
+  /**
+   * Reads multiple (possibly discontiguous) chunks of the remote process' memory using as few syscalls as possible.
+   * The outcome of each request is reported in its ok field, and a failing request doesn't fail the others.
+   * It always reads the remote process directly, bypassing the page cache.
+   * Returns the number of successful requests.
+   */
+  size_t read_batch(std::span<ReadRequest> requests);
+
+  struct WriteRequest {
+    uintptr_t remoteAddr{};
+    const void* dataIn{};
+    size_t dataSize{};
+    bool ok = false; // Set by write_batch
+  };
+
+  /**
+   * Writes multiple (possibly discontiguous) chunks of the remote process' memory using as few syscalls as possible,
+   * so that they land (almost) at the same instant. The outcome of each request is reported in its ok field, and a
+   * failing request doesn't fail the others.
+   * Returns the number of successful requests.
+   */
+  size_t write_batch(std::span<WriteRequest> requests);
+
+protected:
+  size_t read_batch_uncached(std::span<ReadRequest> requests);
+  size_t write_batch_uncached(std::span<WriteRequest> requests);
+
+public:
+  /**
+   * See: RPMInterface::compare_and_write
+   * The checked ranges are read directly, bypassing the page cache (its copies might be stale), in a single batch (see:
+   * read_batch), and the write follows it immediately.
+   */
+  CompareWriteResult compare_and_write(
+    std::span<const CompareRequest> checks, uintptr_t remoteAddr, const void* dataIn, size_t dataSize
+  );
+
+  /**
+   * See: RPMInterface::compare_and_write_batch
+   * Every check is read in a single batch, and then the writes that have passed are written in a single batch (see:
+   * write_batch).
+   */
+  size_t compare_and_write_batch(std::span<CompareWriteRequest> requests);
+
+  static constexpr unsigned LARGE_READ_MAX_THREADS = 8;
+
+  /**
+   * Reads a large range of the remote process' memory (e.g. a whole PE section) in chunks, in parallel, using up to
+   * maxThreads threads (0: as many as the hardware supports, up to LARGE_READ_MAX_THREADS). The chunks that couldn't be
+   * read are zeroed out, and reported in the result, so a partially unreadable range is still usable. The same goes for
+   * the chunks that aren't worth reading according to residency (if given, see: queryPageResidency), except that
+   * they are not even read.
+   * It always reads the remote process directly, bypassing the page cache.
+   */
+  LargeReadResult read_large(
+    uintptr_t remoteAddr, void* dataOut, size_t dataSize, const PageResidency* residency = nullptr,
+    size_t chunkSize = LargeReadResult::DEFAULT_CHUNK_SIZE, unsigned maxThreads = 0
+  );
+
+  /**
+   * Queries the residency of the pages of the given remote range from /proc/<pid>/pagemap, so that bulk reads can skip
+   * the pages that have never been touched (see: PageResidency::isWorthReading).
+   * Only supported on Linux, returns false elsewhere (or on failure).
+   */
+  bool queryPageResidency(uintptr_t remoteAddr, size_t dataSize, PageResidency& residency);
+
+  /**
+   * Clears the soft-dirty bits of every page of the remote process through /proc/<pid>/clear_refs, so that the next
+   * queryPageResidency reports the pages that have been written since (as PageResidency::PAGE_SOFT_DIRTY).
+   * It affects the whole process: each of its pages takes an extra minor fault on its next write.
+   * Only supported on Linux kernels built with CONFIG_MEM_SOFT_DIRTY, returns false elsewhere (or on failure).
+   */
+  bool clearSoftDirty();
+
+public:
+  /**
+   * Queues an asynchronous read or write. The request (and its buffer) must stay alive until it has completed.
+   * Queued requests are handed to the OS together by async_reap (or when the queue gets full), so that hundreds of them
+   * can be carried out in parallel at the cost of a few syscalls. Whenever asynchronous IO is unavailable, the request
+   * is transparently carried out synchronously instead.
+   * Asynchronous requests bypass the page cache (asynchronous writes drop the affected pages from it).
+   */
+  void async_submit(AsyncRequest& request);
+
+  /**
+   * Hands the queued requests to the OS and reaps the completed ones, marking them done.
+   * If wait is true, then it blocks until every pending request has completed.
+   * Returns the number of requests reaped.
+   */
+  size_t async_reap(bool wait = true);
+
+  /**
+   * Returns the number of requests that haven't been reaped yet.
+   */
+  inline size_t async_pending() const { return m_async.pending; }
 };
\ No newline at end of file
@@ -0,0 +1,96 @@
+#if __linux__
+#include <unistd.h>
+#include <sys/uio.h>
+#include <cerrno>
+#elif _WIN32
+#define _AMD64_
+#include <processthreadsapi.h>
+#endif
+
+#include <cstring>
+
+#include "rpm_backends.h"
+
+// -------------------------------------------------------------------
+// - VmReadvRPM
+// -------------------------------------------------------------------
+
+#if __linux__
+
+bool VmReadvRPM::read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
+{
+  if (!this->isOpen())
+    return false;
+
+  const iovec localIov{dataOut, dataSize};
+  const iovec remoteIov{(void*)remoteAddr, dataSize};
+  ++m_syscalls;
+  const ssize_t bytes = ::process_vm_readv(this->getPID(), &localIov, 1, &remoteIov, 1, 0);
+  if (bytes == -1 && errno == ESRCH)
+    this->close();
+  return bytes == (ssize_t)dataSize;
+}
+
+bool VmReadvRPM::write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize)
+{
+  if (!this->isOpen())
+    return false;
+
+  const iovec localIov{(void*)dataIn, dataSize};
+  const iovec remoteIov{(void*)remoteAddr, dataSize};
+  ++m_syscalls;
+  const ssize_t bytes = ::process_vm_writev(this->getPID(), &localIov, 1, &remoteIov, 1, 0);
+  if (bytes == -1 && errno == ESRCH)
+    this->close();
+  return bytes == (ssize_t)dataSize;
+}
+
+#endif
+
+// -------------------------------------------------------------------
+// - SelfRPM
+// -------------------------------------------------------------------
+
+static PID getCurrentPID()
+{
+#if __linux__
+  return ::getpid();
+#elif _WIN32
+  return ::GetCurrentProcessId();
+#endif
+}
+
+WinRPM::OpenResult SelfRPM::open(PID pid)
+{
+  this->close();
+  if (pid != getCurrentPID())
+    return WinRPM::OpenResult::NotFound;
+  if (const auto openResult = m_process.open(pid); openResult != WinRPM::OpenResult::Ok)
+    return openResult;
+  if (!this->refresh()) {
+    this->close();
+    return WinRPM::OpenResult::Error;
+  }
+  return WinRPM::OpenResult::Ok;
+}
+
+WinRPM::OpenResult SelfRPM::open()
+{
+  return this->open(getCurrentPID());
+}
+
+bool SelfRPM::read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
+{
+  if (!m_regions.hasPerms(remoteAddr, dataSize, RegionIndex::PERM_READ))
+    return false;
+  ::memcpy(dataOut, (const void*)remoteAddr, dataSize);
+  return true;
+}
+
+bool SelfRPM::write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize)
+{
+  if (!m_regions.hasPerms(remoteAddr, dataSize, RegionIndex::PERM_READ | RegionIndex::PERM_WRITE))
+    return false;
+  ::memcpy((void*)remoteAddr, dataIn, dataSize);
+  return true;
+}
\ No newline at end of file
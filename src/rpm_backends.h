@@ -0,0 +1,185 @@
+#pragma once
+
+#include <concepts>
+#include <utility>
+
+#include "rpm.h"
+
+/**
+ * What Il2CppRPM and PhasMem expect from a remote memory access backend. Backends are plugged in at compile time (as
+ * template parameters), so that the hot path doesn't go through any virtual calls.
+ * The types (requests, results, etc.) are shared with WinRPM, which is the default backend.
+ */
+template <typename RPM>
+concept RPMBackend = requires(
+  RPM& rpm, const RPM& crpm, PID pid, WinRPM::PathViewType filename, uintptr_t remoteAddr, void* dataOut,
+  const void* dataIn, size_t dataSize, std::span<WinRPM::ReadRequest> readRequests,
+  std::span<WinRPM::WriteRequest> writeRequests, WinRPM::AsyncRequest& asyncRequest,
+  std::span<const WinRPM::PathViewType> filenames, RegionIndex& regionIndex
+) {
+  { rpm.open(pid) } -> std::same_as<WinRPM::OpenResult>;
+  { rpm.open(filename) } -> std::same_as<WinRPM::OpenResult>;
+  rpm.close();
+  { crpm.isOpen() } -> std::same_as<bool>;
+  { rpm.pollIsOpen() } -> std::same_as<bool>;
+  { crpm.getPID() } -> std::same_as<PID>;
+  { rpm.read_raw(remoteAddr, dataOut, dataSize) } -> std::same_as<bool>;
+  { rpm.write_raw(remoteAddr, dataIn, dataSize) } -> std::same_as<bool>;
+  { rpm.read_batch(readRequests) } -> std::same_as<size_t>;
+  { rpm.write_batch(writeRequests) } -> std::same_as<size_t>;
+  rpm.async_submit(asyncRequest);
+  { rpm.async_reap() } -> std::same_as<size_t>;
+  { rpm.getMappedFileInfos(filenames) } -> std::same_as<std::vector<WinRPM::MappedFileInfo>>;
+  { rpm.queryRegions(regionIndex) } -> std::same_as<bool>;
+};
+
+static_assert(RPMBackend<WinRPM>);
+
+/**
+ * A base for the backends that can only carry out requests one by one: batched and asynchronous requests are simply
+ * forwarded to the derived class' read_raw / write_raw.
+ */
+template <typename Derived>
+class SyncBatchRPM : public RPMInterface<Derived>
+{
+protected:
+  size_t m_asyncCompleted = 0;
+
+public:
+  size_t read_batch(std::span<WinRPM::ReadRequest> requests)
+  {
+    auto& self = static_cast<Derived&>(*this);
+    size_t numOk = 0;
+    for (auto& request : requests) {
+      if ((request.ok = self.read_raw(request.remoteAddr, request.dataOut, request.dataSize)))
+        ++numOk;
+    }
+    return numOk;
+  }
+
+  size_t write_batch(std::span<WinRPM::WriteRequest> requests)
+  {
+    auto& self = static_cast<Derived&>(*this);
+    size_t numOk = 0;
+    for (auto& request : requests) {
+      if ((request.ok = self.write_raw(request.remoteAddr, request.dataIn, request.dataSize)))
+        ++numOk;
+    }
+    return numOk;
+  }
+
+  void async_submit(WinRPM::AsyncRequest& request)
+  {
+    auto& self = static_cast<Derived&>(*this);
+    request.ok = request.write ? self.write_raw(request.remoteAddr, request.data, request.dataSize)
+                               : self.read_raw(request.remoteAddr, request.data, request.dataSize);
+    request.done = true;
+    ++m_asyncCompleted;
+  }
+  inline size_t async_reap(bool = true) { return std::exchange(m_asyncCompleted, 0); }
+};
+
+/**
+ * A base for the backends that access the memory of a live process in some other way than WinRPM does. The process
+ * itself (its handles, its memory regions, etc.) is still managed by a WinRPM instance, and only the data access is
+ * up to the derived class, which has to implement read_raw and write_raw.
+ */
+template <typename Derived>
+class ProcessBackedRPM : public SyncBatchRPM<Derived>
+{
+protected:
+  WinRPM m_process;
+
+public:
+  inline WinRPM::OpenResult open(PID pid) { return m_process.open(pid); }
+  inline WinRPM::OpenResult open(WinRPM::PathViewType processFilename)
+  {
+    auto& self = static_cast<Derived&>(*this);
+    self.close();
+    if (PID pid = WinRPM::getPIDByFilename(processFilename))
+      return self.open(pid);
+    return WinRPM::OpenResult::NotFound;
+  }
+
+  inline void close() { m_process.close(); }
+  inline bool isOpen() const { return m_process.isOpen(); }
+  explicit inline operator bool() const { return isOpen(); }
+  inline bool pollIsOpen() { return m_process.pollIsOpen(); }
+  inline PID getPID() const { return m_process.getPID(); }
+  inline WinRPM::ExitWaitHandle getExitWaitHandle() const { return m_process.getExitWaitHandle(); }
+
+  inline std::vector<WinRPM::MappedFileInfo> getMappedFileInfos(std::span<const WinRPM::PathViewType> filenames)
+  {
+    return m_process.getMappedFileInfos(filenames);
+  }
+  inline bool queryRegions(RegionIndex& index) { return m_process.queryRegions(index); }
+};
+
+#if __linux__
+/**
+ * Accesses the remote process with process_vm_readv / process_vm_writev instead of /proc/<pid>/mem.
+ * It has neither a page cache, nor a real asynchronous queue.
+ */
+class VmReadvRPM : public ProcessBackedRPM<VmReadvRPM>
+{
+protected:
+  uint64_t m_syscalls = 0;
+
+public:
+  /**
+   * See: WinRPM::getSyscallCount
+   */
+  inline uint64_t getSyscallCount() const { return m_syscalls + m_process.getSyscallCount(); }
+
+  bool read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize);
+  bool write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize);
+
+  /**
+   * See: WinRPM::read_batch / write_batch (which already use process_vm_readv / process_vm_writev)
+   */
+  inline size_t read_batch(std::span<WinRPM::ReadRequest> requests) { return m_process.read_batch(requests); }
+  inline size_t write_batch(std::span<WinRPM::WriteRequest> requests) { return m_process.write_batch(requests); }
+};
+
+static_assert(RPMBackend<VmReadvRPM>);
+#endif
+
+/**
+ * Accesses the memory of the current process directly (i.e. with memcpy), without any syscalls. It's meant for running
+ * the il2cpp code against a local stand-in of the game, and for measuring the cost of everything but the data access.
+ * Accesses are validated against a snapshot of our own memory regions, which must be refreshed (see: refresh) after
+ * the regions of interest have been mapped.
+ */
+class SelfRPM : public ProcessBackedRPM<SelfRPM>
+{
+protected:
+  RegionIndex m_regions;
+
+public:
+  /**
+   * Only the current process can be opened.
+   */
+  WinRPM::OpenResult open(PID pid);
+  using ProcessBackedRPM::open;
+
+  /**
+   * Opens the current process.
+   */
+  WinRPM::OpenResult open();
+
+  inline void close()
+  {
+    m_regions.clear();
+    m_process.close();
+  }
+
+  /**
+   * Rebuilds the snapshot of our memory regions.
+   */
+  inline bool refresh() { return m_process.queryRegions(m_regions); }
+
+  bool read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize);
+  bool write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize);
+};
+
+static_assert(RPMBackend<SelfRPM>);
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "rpm_stats.h"
+
+using namespace rpm_stats;
+
+#if RPM_STATS
+
+Counters rpm_stats::g_counters[TAG_COUNT][OP_COUNT];
+thread_local Tag rpm_stats::t_tag = TAG_UNTAGGED;
+
+/**
+ * Returns the upper bound of the latency bucket that the given fraction of the calls fall under.
+ */
+static uint64_t latencyPercentile(const Counters& counters, double fraction)
+{
+  uint64_t total = 0;
+  for (const auto& bucket : counters.latency)
+    total += bucket.load(std::memory_order_relaxed);
+  if (!total)
+    return 0;
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+    seen += counters.latency[i].load(std::memory_order_relaxed);
+    if (seen >= fraction * total)
+      return 1ull << i;
+  }
+  return 1ull << (LATENCY_BUCKETS - 1);
+}
+
+void rpm_stats::dump(std::ostream& os)
+{
+  os << "[Debug]: RPM statistics (tag / op: calls, bytes, failures, syscalls, latency p50 / p99 upper bounds):\n";
+  for (size_t tag = 0; tag < TAG_COUNT; ++tag) {
+    for (size_t op = 0; op < OP_COUNT; ++op) {
+      const auto& counters = g_counters[tag][op];
+      const uint64_t calls = counters.calls.load(std::memory_order_relaxed);
+      const uint64_t syscalls = counters.syscalls.load(std::memory_order_relaxed);
+      if (!calls && !syscalls)
+        continue;
+      os << "  " << TAG_NAMES[tag] << " / " << OP_NAMES[op] << ": " << calls << ", "
+         << counters.bytes.load(std::memory_order_relaxed) << ", "
+         << counters.failures.load(std::memory_order_relaxed) << ", " << syscalls << ", "
+         << latencyPercentile(counters, 0.5) << "ns / " << latencyPercentile(counters, 0.99) << "ns\n";
+    }
+  }
+}
+
+void rpm_stats::exportJson(std::ostream& os)
+{
+  os << "{\"latencyBuckets\":" << LATENCY_BUCKETS << ",\"tags\":{";
+  for (size_t tag = 0; tag < TAG_COUNT; ++tag) {
+    os << (tag ? "," : "") << "\"" << TAG_NAMES[tag] << "\":{";
+    for (size_t op = 0; op < OP_COUNT; ++op) {
+      const auto& counters = g_counters[tag][op];
+      os << (op ? "," : "") << "\"" << OP_NAMES[op] << "\":{"
+         << "\"calls\":" << counters.calls.load(std::memory_order_relaxed)
+         << ",\"bytes\":" << counters.bytes.load(std::memory_order_relaxed)
+         << ",\"failures\":" << counters.failures.load(std::memory_order_relaxed)
+         << ",\"syscalls\":" << counters.syscalls.load(std::memory_order_relaxed) << ",\"latencyNs\":[";
+      for (size_t i = 0; i < LATENCY_BUCKETS; ++i)
+        os << (i ? "," : "") << counters.latency[i].load(std::memory_order_relaxed);
+      os << "]}";
+    }
+    os << "}";
+  }
+  os << "}}\n";
+}
+
+void rpm_stats::reset()
+{
+  for (auto& tagCounters : g_counters) {
+    for (auto& counters : tagCounters) {
+      counters.calls.store(0, std::memory_order_relaxed);
+      counters.bytes.store(0, std::memory_order_relaxed);
+      counters.failures.store(0, std::memory_order_relaxed);
+      counters.syscalls.store(0, std::memory_order_relaxed);
+      for (auto& bucket : counters.latency)
+        bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+#else
+
+void rpm_stats::dump(std::ostream& os)
+{
+  os << "[Debug]: RPM statistics were compiled out (see: the PGVCF_RPM_STATS CMake option).\n";
+}
+
+void rpm_stats::exportJson(std::ostream& os)
+{
+  os << "{\"latencyBuckets\":" << LATENCY_BUCKETS << ",\"tags\":{}}\n";
+}
+
+void rpm_stats::reset() {}
+
+#endif
\ No newline at end of file
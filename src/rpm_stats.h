@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+
+// Enabled by the PGVCF_RPM_STATS CMake option
+#ifndef RPM_STATS
+#define RPM_STATS 0
+#endif
+
+/**
+ * Per call site statistics of the remote memory accesses made through WinRPM: the number of calls, bytes, failures and
+ * syscalls, and a log2 bucketed latency histogram.
+ *
+ * The accesses are attributed to the tag of the calling thread (see: ScopedTag), so that the callers don't have to pass
+ * anything down to WinRPM. The counters are process-wide relaxed atomics, so they are thread-safe and lock-free.
+ * When compiled out (RPM_STATS=0), everything here is an empty inline function, so it costs nothing.
+ */
+namespace rpm_stats {
+
+inline constexpr bool ENABLED = RPM_STATS;
+
+enum Tag : uint8_t {
+  TAG_UNTAGGED,
+  TAG_ATTACH,
+  TAG_DATA_SCAN,
+  TAG_ENUM_FIELDS,
+  TAG_STRING_READ,
+  TAG_FIX_TICK,
+  TAG_COUNT
+};
+inline constexpr const char* TAG_NAMES[TAG_COUNT] = {
+  "untagged", "attach", "data-scan", "enumFields", "string-read", "fix-tick"
+};
+
+enum Op : uint8_t {
+  OP_READ,
+  OP_WRITE,
+  OP_ASYNC, // Asynchronous reads and writes (their latency is that of the syscalls submitting / reaping them)
+  OP_COUNT
+};
+inline constexpr const char* OP_NAMES[OP_COUNT] = {"read", "write", "async"};
+
+// Bucket i holds the latencies in [2^(i - 1), 2^i) ns, and the last one holds everything above
+inline constexpr size_t LATENCY_BUCKETS = 32;
+
+struct Counters {
+  std::atomic<uint64_t> calls{};
+  std::atomic<uint64_t> bytes{};
+  std::atomic<uint64_t> failures{};
+  std::atomic<uint64_t> syscalls{};
+  std::array<std::atomic<uint64_t>, LATENCY_BUCKETS> latency{};
+};
+
+#if RPM_STATS
+extern Counters g_counters[TAG_COUNT][OP_COUNT];
+extern thread_local Tag t_tag;
+#endif
+
+/**
+ * Attributes the remote memory accesses of the current thread to the given tag, for as long as it's alive.
+ */
+class ScopedTag
+{
+#if RPM_STATS
+  Tag m_prevTag;
+
+public:
+  explicit inline ScopedTag(Tag tag) : m_prevTag(std::exchange(t_tag, tag)) {}
+  inline ~ScopedTag() { t_tag = m_prevTag; }
+#else
+public:
+  explicit inline ScopedTag(Tag) {}
+#endif
+
+  ScopedTag(const ScopedTag&) = delete;
+  ScopedTag& operator=(const ScopedTag&) = delete;
+};
+
+/**
+ * Adds an access (or a batch of them) to the counters of the current tag. A negative latency means that it's unknown.
+ */
+#if RPM_STATS
+inline void record(Op op, uint64_t calls, uint64_t bytes, uint64_t failures, uint64_t syscalls, int64_t latencyNs)
+{
+  auto& counters = g_counters[t_tag][op];
+  counters.calls.fetch_add(calls, std::memory_order_relaxed);
+  counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  counters.failures.fetch_add(failures, std::memory_order_relaxed);
+  counters.syscalls.fetch_add(syscalls, std::memory_order_relaxed);
+  if (latencyNs >= 0) {
+    const size_t bucket = std::min<size_t>(std::bit_width((uint64_t)latencyNs), LATENCY_BUCKETS - 1);
+    counters.latency[bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+}
+#else
+inline void record(Op, uint64_t, uint64_t, uint64_t, uint64_t, int64_t) {}
+#endif
+
+/**
+ * Measures the latency and the number of syscalls of an access, and records it once it has finished.
+ */
+class CallTimer
+{
+#if RPM_STATS
+  std::chrono::steady_clock::time_point m_start;
+  uint64_t m_syscalls;
+
+public:
+  explicit inline CallTimer(uint64_t syscalls) : m_start(std::chrono::steady_clock::now()), m_syscalls(syscalls) {}
+  inline void finish(Op op, uint64_t calls, uint64_t bytes, uint64_t failures, uint64_t syscalls) const
+  {
+    const auto latency = std::chrono::steady_clock::now() - m_start;
+    record(
+      op, calls, bytes, failures, syscalls - m_syscalls,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()
+    );
+  }
+#else
+public:
+  explicit inline CallTimer(uint64_t) {}
+  inline void finish(Op, uint64_t, uint64_t, uint64_t, uint64_t) const {}
+#endif
+};
+
+/**
+ * Prints a human readable summary of the non-empty counters.
+ */
+void dump(std::ostream& os);
+
+/**
+ * Writes every counter (including the whole latency histograms) as JSON.
+ */
+void exportJson(std::ostream& os);
+
+/**
+ * Zeroes every counter.
+ */
+void reset();
+
+} // namespace rpm_stats
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "rpm_trace.h"
+#include "snapshot.h"
+
+using namespace rpm_trace;
+
+static constexpr uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// -------------------------------------------------------------------
+// - Recording
+// -------------------------------------------------------------------
+
+bool WinRPM::startTrace(const std::filesystem::path& tracePath)
+{
+  this->stopTrace();
+
+  RegionIndex regions;
+  if (!this->queryRegions(regions))
+    return false;
+
+  std::filesystem::path::string_type stringPool;
+  std::vector<snapshot::SnapshotRegion> traceRegions;
+  traceRegions.reserve(regions.size());
+  for (const auto& region : regions.regions()) {
+    traceRegions.push_back(
+      {region.range.start, region.range.end, region.fileOffset, (uint32_t)stringPool.size(), region.pathSize,
+       region.perms, 0}
+    );
+    stringPool.append(regions.path(region));
+  }
+
+  TraceHeader header{};
+  ::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.pid = (uint64_t)this->getPID();
+  header.regionCount = traceRegions.size();
+  header.stringPoolSize = stringPool.size();
+
+  auto trace = std::make_unique<Trace>();
+  trace->os.open(tracePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  if (!trace->os)
+    return false;
+
+  trace->os.write((const char*)&header, sizeof(header));
+  trace->os.write((const char*)traceRegions.data(), traceRegions.size() * sizeof(snapshot::SnapshotRegion));
+  trace->os.write((const char*)stringPool.data(), stringPool.size() * sizeof(stringPool[0]));
+  static constexpr char zeros[RECORD_ALIGNMENT]{};
+  const uint64_t tablesSize = trace->os.tellp();
+  trace->os.write(zeros, alignUp(tablesSize, RECORD_ALIGNMENT) - tablesSize);
+  if (!trace->os)
+    return false;
+
+  trace->start = std::chrono::steady_clock::now();
+  trace->lastSyscalls = m_syscalls;
+  m_trace = std::move(trace);
+  return true;
+}
+
+void WinRPM::stopTrace()
+{
+  if (!m_trace)
+    return;
+  m_trace->os.flush();
+  m_trace = nullptr;
+}
+
+void WinRPM::trace_record(bool write, uintptr_t remoteAddr, const void* data, size_t dataSize, bool ok)
+{
+  TraceRecord record{};
+  record.timestampNs =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_trace->start).count();
+  record.remoteAddr = remoteAddr;
+  record.dataSize = dataSize;
+  record.op = write ? TRACE_OP_WRITE : TRACE_OP_READ;
+  record.ok = ok;
+  record.syscalls = (uint16_t)std::min<uint64_t>(m_syscalls - m_trace->lastSyscalls, UINT16_MAX);
+  m_trace->lastSyscalls = m_syscalls;
+  ++m_trace->records;
+
+  auto& os = m_trace->os;
+  os.write((const char*)&record, sizeof(record));
+  if (hasData(record)) {
+    static constexpr char zeros[RECORD_ALIGNMENT]{};
+    os.write((const char*)data, dataSize);
+    os.write(zeros, alignUp(dataSize, RECORD_ALIGNMENT) - dataSize);
+  }
+}
+
+// -------------------------------------------------------------------
+// - ReplayRPM
+// -------------------------------------------------------------------
+
+WinRPM::OpenResult ReplayRPM::open(WinRPM::PathViewType tracePath)
+{
+  this->close();
+
+  std::error_code fec;
+  if (!std::filesystem::is_regular_file(tracePath, fec))
+    return WinRPM::OpenResult::NotFound;
+  if (!m_view.open(tracePath))
+    return WinRPM::OpenResult::Error;
+
+  const auto fail = [this]() {
+    this->close();
+    return WinRPM::OpenResult::Error;
+  };
+
+  // Validate the header and the tables
+  const size_t size = m_view.size();
+  if (size < sizeof(TraceHeader))
+    return fail();
+  const auto& header = m_view.get<TraceHeader>(0);
+  if (::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+    return fail();
+
+  // The counts are bounded first, so that none of the offsets below can overflow
+  using CharType = std::filesystem::path::value_type;
+  if (header.regionCount > size / sizeof(snapshot::SnapshotRegion) || header.stringPoolSize > size / sizeof(CharType))
+    return fail();
+  const uint64_t regionsOffset = sizeof(TraceHeader);
+  const uint64_t stringPoolOffset = regionsOffset + header.regionCount * sizeof(snapshot::SnapshotRegion);
+  const uint64_t recordsOffset = alignUp(stringPoolOffset + header.stringPoolSize * sizeof(CharType), RECORD_ALIGNMENT);
+  if (recordsOffset > size)
+    return fail();
+
+  // Rebuild the region index
+  const std::basic_string_view<CharType> stringPool{
+    m_view.getPtr<CharType>(stringPoolOffset), (size_t)header.stringPoolSize
+  };
+  for (const auto& region :
+       std::span{m_view.getPtr<snapshot::SnapshotRegion>(regionsOffset), (size_t)header.regionCount}) {
+    if ((uint64_t)region.pathOffset + region.pathSize > stringPool.size() || region.end < region.start)
+      return fail();
+    m_regions.add(
+      {region.start, region.end}, (uint8_t)region.perms, region.fileOffset,
+      stringPool.substr(region.pathOffset, region.pathSize)
+    );
+  }
+
+  // Index the records. A truncated last record (e.g. the recording process was killed) is ignored.
+  for (uint64_t offset = recordsOffset; offset + sizeof(TraceRecord) <= size;) {
+    const auto& record = m_view.get<TraceRecord>(offset);
+    const uint64_t dataSize = hasData(record) ? alignUp(record.dataSize, RECORD_ALIGNMENT) : 0;
+    if (record.dataSize > size || offset + sizeof(TraceRecord) + dataSize > size)
+      break;
+    m_entries.push_back({&record, false});
+    offset += sizeof(TraceRecord) + dataSize;
+  }
+
+  m_header = &header;
+  return WinRPM::OpenResult::Ok;
+}
+
+void ReplayRPM::close()
+{
+  m_header = nullptr;
+  m_regions.clear();
+  m_entries.clear();
+  m_cursor = 0;
+  m_stats = {};
+  m_view.close();
+}
+
+const TraceRecord* ReplayRPM::consume(TraceOp op, uintptr_t remoteAddr, size_t dataSize)
+{
+  ++m_stats.requests;
+
+  const size_t end = std::min(m_entries.size(), m_cursor + MATCH_WINDOW);
+  for (size_t i = m_cursor; i < end; ++i) {
+    auto& entry = m_entries[i];
+    if (entry.consumed || entry.record->op != op || entry.record->remoteAddr != remoteAddr ||
+        entry.record->dataSize != dataSize)
+      continue;
+
+    entry.consumed = true;
+    while (m_cursor < m_entries.size() && m_entries[m_cursor].consumed)
+      ++m_cursor;
+    m_stats.bytes += dataSize;
+    m_stats.recordedSyscalls += entry.record->syscalls;
+    return entry.record;
+  }
+
+  ++m_stats.misses;
+  return nullptr;
+}
+
+bool ReplayRPM::read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
+{
+  const auto* record = this->consume(TRACE_OP_READ, remoteAddr, dataSize);
+  if (!record || !record->ok)
+    return false;
+  ::memcpy(dataOut, record + 1, dataSize);
+  return true;
+}
+
+bool ReplayRPM::write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize)
+{
+  const auto* record = this->consume(TRACE_OP_WRITE, remoteAddr, dataSize);
+  if (!record)
+    return false;
+  if (::memcmp(dataIn, record + 1, dataSize) != 0)
+    ++m_stats.divergentWrites;
+  return record->ok;
+}
+
+std::vector<WinRPM::MappedFileInfo> ReplayRPM::getMappedFileInfos(std::span<const WinRPM::PathViewType> filenames)
+{
+  return WinRPM::findMappedFiles(m_regions, filenames);
+}
+
+bool ReplayRPM::queryRegions(RegionIndex& index)
+{
+  index = m_regions;
+  return this->isOpen();
+}
+
+size_t ReplayRPM::getUnconsumedCount() const
+{
+  return std::count_if(m_entries.begin() + m_cursor, m_entries.end(), [](const Entry& entry) {
+    return !entry.consumed;
+  });
+}
\ No newline at end of file
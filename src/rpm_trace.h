@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "rpm.h"
+#include "rpm_backends.h"
+#include "mmap_view.h"
+
+/**
+ * Transaction traces of a remote process (see: WinRPM::startTrace).
+ *
+ * A trace holds the memory regions table of the process at the time the recording was started, followed by every read
+ * and write that went through WinRPM (including the ones coming from batches and asynchronous requests) in the order
+ * they have completed, along with their outcome, the data transferred and the number of syscalls they took. It can
+ * be replayed by ReplayRPM, so that the il2cpp code can be run offline, with exactly the same inputs as the recorded
+ * run.
+ *
+ * Unlike snapshots (see: snapshot.h), traces don't embed any files, so replaying them requires the mapped files (e.g.
+ * global-metadata.dat) to exist at their recorded paths.
+ *
+ * Layout (native byte order, so a trace is only meant to be replayed on the platform it was recorded on):
+ *  TraceHeader
+ *  snapshot::SnapshotRegion[regionCount]
+ *  path::value_type[stringPoolSize]    (the paths of the regions)
+ *  (padding up to 8 bytes)
+ *  { TraceRecord, unsigned char[dataSize] (only for successful reads and all writes), (padding up to 8 bytes) }...
+ */
+namespace rpm_trace {
+
+inline constexpr char MAGIC[8] = {'P', 'G', 'V', 'C', 'T', 'R', 'C', 'E'};
+inline constexpr uint32_t VERSION = 1;
+inline constexpr uint64_t RECORD_ALIGNMENT = 8;
+
+struct TraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t pid;
+  uint64_t regionCount;
+  uint64_t stringPoolSize;
+};
+
+enum TraceOp : uint8_t {
+  TRACE_OP_READ = 0,
+  TRACE_OP_WRITE = 1
+};
+
+struct TraceRecord {
+  uint64_t timestampNs; // Since the start of the recording
+  uint64_t remoteAddr;
+  uint64_t dataSize;
+  uint8_t op; // TraceOp
+  uint8_t ok;
+  uint16_t syscalls; // Issued since the previous record (saturated)
+  uint32_t reserved;
+};
+
+/**
+ * Returns whether the data of the record is stored in the trace.
+ */
+inline constexpr bool hasData(const TraceRecord& record)
+{
+  return record.op == TRACE_OP_WRITE || record.ok;
+}
+
+} // namespace rpm_trace
+
+/**
+ * A read-only backend that replays a trace (see: rpm_trace.h) as if it were a live process.
+ *
+ * Each request is matched against the earliest unconsumed record with the same operation, address and size, which is
+ * then consumed: reads are served with the recorded data and outcome, and writes report the recorded outcome (and are
+ * checked against the recorded data, but are discarded otherwise). Asynchronous requests might complete in a
+ * different order than they were submitted, so the match is searched for within a window of records, rather than
+ * only at the next one. Requests without a match fail.
+ */
+class ReplayRPM : public SyncBatchRPM<ReplayRPM>
+{
+public:
+  struct ReplayStats {
+    uint64_t requests = 0;
+    uint64_t misses = 0;           // Requests without a matching record
+    uint64_t divergentWrites = 0;  // Writes whose data differs from the recorded one
+    uint64_t bytes = 0;            // Transferred by the matched requests
+    uint64_t recordedSyscalls = 0; // Taken by the matched requests, when they were recorded
+  };
+
+  // How many records ahead to search for a match
+  static constexpr size_t MATCH_WINDOW = 1024;
+
+protected:
+  MmapView m_view;
+  const rpm_trace::TraceHeader* m_header = nullptr;
+  RegionIndex m_regions;
+
+  struct Entry {
+    const rpm_trace::TraceRecord* record;
+    bool consumed;
+  };
+  std::vector<Entry> m_entries;
+  size_t m_cursor = 0; // The first unconsumed entry
+  ReplayStats m_stats;
+
+  /**
+   * Finds and consumes the record matching the given request, or returns a null pointer.
+   */
+  const rpm_trace::TraceRecord* consume(rpm_trace::TraceOp op, uintptr_t remoteAddr, size_t dataSize);
+
+public:
+  ReplayRPM() noexcept = default;
+  ~ReplayRPM() { this->close(); }
+
+  /**
+   * Opens a trace file.
+   */
+  WinRPM::OpenResult open(WinRPM::PathViewType tracePath);
+
+  /**
+   * Traces have no live processes to open.
+   */
+  inline WinRPM::OpenResult open(PID) { return WinRPM::OpenResult::NotFound; }
+
+  void close();
+  inline bool isOpen() const { return m_header != nullptr; }
+  explicit inline operator bool() const { return isOpen(); }
+  inline bool pollIsOpen() { return this->isOpen(); }
+
+  /**
+   * Returns the PID of the process that the trace was recorded from.
+   */
+  inline PID getPID() const { return m_header ? (PID)m_header->pid : 0; }
+
+  bool read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize);
+  bool write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize);
+
+  /**
+   * See: WinRPM::getMappedFileInfos
+   */
+  std::vector<WinRPM::MappedFileInfo> getMappedFileInfos(std::span<const WinRPM::PathViewType> filenames);
+
+  /**
+   * Returns the regions table of the trace.
+   */
+  bool queryRegions(RegionIndex& index);
+
+  /**
+   * Returns the number of records in the trace, and the number of them that haven't been replayed yet.
+   */
+  inline size_t getRecordCount() const { return m_entries.size(); }
+  size_t getUnconsumedCount() const;
+
+  inline const ReplayStats& getReplayStats() const { return m_stats; }
+};
+
+static_assert(RPMBackend<ReplayRPM>);
\ No newline at end of file
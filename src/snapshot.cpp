@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+
+#include "snapshot.h"
+
+using namespace snapshot;
+
+static constexpr size_t PAGE_SIZE = WinRPM::PAGE_CACHE_PAGE_SIZE;
+
+static constexpr uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t hashData(std::span<const unsigned char> data)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const unsigned char c : data)
+    hash = (hash ^ c) * 0x100000001b3ull;
+  return hash;
+}
+
+/**
+ * Returns whether the file at the given path exists, and holds exactly the given data.
+ */
+static bool fileMatches(const std::filesystem::path& path, std::span<const unsigned char> data)
+{
+  std::error_code fec;
+  if (std::filesystem::file_size(path, fec) != data.size() || fec)
+    return false;
+  if (data.empty())
+    return true;
+
+  const MmapView view(path, MmapView::MapMode::Lazy);
+  return view && view.size() == data.size() && ::memcmp(view.data(), data.data(), data.size()) == 0;
+}
+
+// -------------------------------------------------------------------
+// - Capture
+// -------------------------------------------------------------------
+
+bool snapshot::capture(const std::filesystem::path& snapshotPath, WinRPM& rpm, std::span<const EmbeddedFile> files)
+{
+  RegionIndex regions;
+  if (!rpm.queryRegions(regions))
+    return false;
+
+  // Read the touched pages again (bypassing the page cache), and keep the ones that are still readable
+  const auto touchedPages = rpm.getTouchedPages();
+  std::vector<unsigned char> pageData(touchedPages.size() * PAGE_SIZE);
+  std::vector<WinRPM::ReadRequest> requests(touchedPages.size());
+  for (size_t i = 0; i < touchedPages.size(); ++i)
+    requests[i] = {touchedPages[i], &pageData[i * PAGE_SIZE], PAGE_SIZE};
+  rpm.read_batch(requests);
+
+  std::vector<uint64_t> pageAddrs;
+  pageAddrs.reserve(requests.size());
+  for (size_t i = 0; i < requests.size(); ++i) {
+    if (!requests[i].ok)
+      continue;
+    ::memmove(&pageData[pageAddrs.size() * PAGE_SIZE], &pageData[i * PAGE_SIZE], PAGE_SIZE);
+    pageAddrs.push_back(requests[i].remoteAddr);
+  }
+  pageData.resize(pageAddrs.size() * PAGE_SIZE);
+
+  // Build the tables
+  std::filesystem::path::string_type stringPool;
+  std::vector<SnapshotRegion> snapRegions;
+  snapRegions.reserve(regions.size());
+  for (const auto& region : regions.regions()) {
+    snapRegions.push_back(
+      {region.range.start, region.range.end, region.fileOffset, (uint32_t)stringPool.size(), region.pathSize,
+       region.perms, 0}
+    );
+    stringPool.append(regions.path(region));
+  }
+
+  SnapshotHeader header{};
+  ::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.pageSize = PAGE_SIZE;
+  header.pid = (uint64_t)rpm.getPID();
+  header.regionCount = snapRegions.size();
+  header.fileCount = files.size();
+  header.pageCount = pageAddrs.size();
+
+  std::vector<SnapshotFile> snapFiles;
+  snapFiles.reserve(files.size());
+  for (const auto& file : files) {
+    snapFiles.push_back(
+      {(uint32_t)stringPool.size(), (uint32_t)file.name.size(), 0, file.data.size(), hashData(file.data)}
+    );
+    stringPool.append(file.name);
+  }
+  header.stringPoolSize = stringPool.size();
+
+  const uint64_t tablesSize = sizeof(header) + snapRegions.size() * sizeof(SnapshotRegion) +
+                              snapFiles.size() * sizeof(SnapshotFile) +
+                              stringPool.size() * sizeof(stringPool[0]) + pageAddrs.size() * sizeof(uint64_t);
+  header.pageDataOffset = alignUp(tablesSize, PAGE_SIZE);
+  uint64_t dataOffset = header.pageDataOffset + pageData.size();
+  for (auto& snapFile : snapFiles) {
+    snapFile.dataOffset = dataOffset;
+    dataOffset = alignUp(dataOffset + snapFile.dataSize, PAGE_SIZE);
+  }
+
+  // Write everything out
+  std::ofstream os(snapshotPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  if (!os)
+    return false;
+
+  const auto writePadding = [&os](uint64_t offset) {
+    static constexpr char zeros[PAGE_SIZE]{};
+    os.write(zeros, offset - (uint64_t)os.tellp());
+  };
+
+  os.write((const char*)&header, sizeof(header));
+  os.write((const char*)snapRegions.data(), snapRegions.size() * sizeof(SnapshotRegion));
+  os.write((const char*)snapFiles.data(), snapFiles.size() * sizeof(SnapshotFile));
+  os.write((const char*)stringPool.data(), stringPool.size() * sizeof(stringPool[0]));
+  os.write((const char*)pageAddrs.data(), pageAddrs.size() * sizeof(uint64_t));
+  writePadding(header.pageDataOffset);
+  os.write((const char*)pageData.data(), pageData.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    writePadding(snapFiles[i].dataOffset);
+    os.write((const char*)files[i].data.data(), files[i].data.size());
+  }
+
+  return (bool)os;
+}
+
+// -------------------------------------------------------------------
+// - SnapshotRPM
+// -------------------------------------------------------------------
+
+WinRPM::OpenResult SnapshotRPM::open(WinRPM::PathViewType snapshotPath)
+{
+  this->close();
+
+  std::error_code fec;
+  if (!std::filesystem::is_regular_file(snapshotPath, fec))
+    return WinRPM::OpenResult::NotFound;
+  if (!m_view.open(snapshotPath))
+    return WinRPM::OpenResult::Error;
+
+  const auto fail = [this]() {
+    this->close();
+    return WinRPM::OpenResult::Error;
+  };
+
+  // Validate the header and the tables
+  const size_t size = m_view.size();
+  if (size < sizeof(SnapshotHeader))
+    return fail();
+  const auto& header = m_view.get<SnapshotHeader>(0);
+  if (::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.pageSize != PAGE_SIZE)
+    return fail();
+
+  // The counts are bounded first, so that none of the offsets below can overflow
+  using CharType = std::filesystem::path::value_type;
+  if (header.regionCount > size / sizeof(SnapshotRegion) || header.fileCount > size / sizeof(SnapshotFile) ||
+      header.stringPoolSize > size / sizeof(CharType) || header.pageCount > size / PAGE_SIZE ||
+      header.pageDataOffset > size)
+    return fail();
+  const uint64_t regionsOffset = sizeof(SnapshotHeader);
+  const uint64_t filesOffset = regionsOffset + header.regionCount * sizeof(SnapshotRegion);
+  const uint64_t stringPoolOffset = filesOffset + header.fileCount * sizeof(SnapshotFile);
+  const uint64_t pageAddrsOffset = stringPoolOffset + header.stringPoolSize * sizeof(CharType);
+  if (pageAddrsOffset + header.pageCount * sizeof(uint64_t) > header.pageDataOffset ||
+      header.pageDataOffset + header.pageCount * PAGE_SIZE > size)
+    return fail();
+
+  const std::basic_string_view<CharType> stringPool{
+    m_view.getPtr<CharType>(stringPoolOffset), (size_t)header.stringPoolSize
+  };
+  const auto getString = [&](uint32_t offset, uint32_t size) -> std::optional<std::basic_string_view<CharType>> {
+    if ((uint64_t)offset + size > stringPool.size())
+      return std::nullopt;
+    return stringPool.substr(offset, size);
+  };
+
+  // Rebuild the region index
+  for (const auto& region : std::span{m_view.getPtr<SnapshotRegion>(regionsOffset), (size_t)header.regionCount}) {
+    const auto path = getString(region.pathOffset, region.pathSize);
+    if (!path || region.end < region.start)
+      return fail();
+    m_regions.add({region.start, region.end}, (uint8_t)region.perms, region.fileOffset, *path);
+  }
+
+  // Extract the embedded files, so that they can be mapped like the original ones
+  //  Each file goes into a directory named after the hash of its contents, so a previously extracted copy can be reused
+  //  (as long as its contents still match), but it's never mixed up with the file of another snapshot. Files are
+  //  written under a temporary name first, so that an interrupted extraction doesn't leave a truncated copy behind.
+  //  The names come from the snapshot, so only plain file names are accepted, otherwise a crafted snapshot could write
+  //  outside of the extraction directory.
+  const auto extractRoot = std::filesystem::temp_directory_path(fec) / "phasmo_global_vc_fixer_snapshot";
+  for (const auto& file : std::span{m_view.getPtr<SnapshotFile>(filesOffset), (size_t)header.fileCount}) {
+    const auto name = getString(file.nameOffset, file.nameSize);
+    if (!name || file.dataOffset > size || file.dataSize > size - file.dataOffset)
+      return fail();
+    const std::filesystem::path namePath{*name};
+    if (name->empty() || namePath.filename() != namePath || namePath == "." || namePath == "..")
+      return fail();
+    const std::span data{m_view.getPtr<unsigned char>(file.dataOffset), (size_t)file.dataSize};
+    if (hashData(data) != file.dataHash)
+      return fail();
+
+    char hashStr[17];
+    ::snprintf(hashStr, sizeof(hashStr), "%016llx", (unsigned long long)file.dataHash);
+    const auto extractDir = extractRoot / hashStr;
+    auto path = extractDir / namePath;
+    if (!fileMatches(path, data)) {
+      std::filesystem::create_directories(extractDir, fec);
+      auto tempPath = path;
+      tempPath += ".tmp";
+      {
+        std::ofstream os(tempPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        os.write((const char*)data.data(), data.size());
+        if (!os)
+          return fail();
+      }
+      std::filesystem::rename(tempPath, path, fec);
+      if (fec)
+        return fail();
+    }
+    m_files.push_back({std::filesystem::path::string_type{*name}, std::move(path)});
+  }
+
+  m_pageAddrs = {m_view.getPtr<uint64_t>(pageAddrsOffset), (size_t)header.pageCount};
+  m_pageData = m_view.getPtr<unsigned char>(header.pageDataOffset);
+  m_header = &header;
+  return WinRPM::OpenResult::Ok;
+}
+
+void SnapshotRPM::close()
+{
+  m_header = nullptr;
+  m_pageAddrs = {};
+  m_pageData = nullptr;
+  m_regions.clear();
+  m_files.clear();
+  m_view.close();
+}
+
+const void* SnapshotRPM::view(uintptr_t remoteAddr, size_t dataSize) const
+{
+  if (!this->isOpen() || !dataSize)
+    return nullptr;
+
+  // The page addresses are sorted and unique, so the range is captured iff both its first and its last page are, and
+  // there is the right number of pages in between.
+  const uintptr_t firstPage = remoteAddr & ~(PAGE_SIZE - 1);
+  const uintptr_t lastPage = (remoteAddr + dataSize - 1) & ~(PAGE_SIZE - 1);
+  const auto it = std::lower_bound(m_pageAddrs.begin(), m_pageAddrs.end(), firstPage);
+  if (it == m_pageAddrs.end() || *it != firstPage)
+    return nullptr;
+  const size_t firstIdx = it - m_pageAddrs.begin();
+  const size_t lastIdx = firstIdx + (lastPage - firstPage) / PAGE_SIZE;
+  if (lastIdx >= m_pageAddrs.size() || m_pageAddrs[lastIdx] != lastPage)
+    return nullptr;
+
+  return m_pageData + firstIdx * PAGE_SIZE + (remoteAddr - firstPage);
+}
+
+bool SnapshotRPM::read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize)
+{
+  if (!dataSize)
+    return this->isOpen();
+  const void* data = this->view(remoteAddr, dataSize);
+  if (!data)
+    return false;
+  ::memcpy(dataOut, data, dataSize);
+  return true;
+}
+
+bool SnapshotRPM::write_raw(uintptr_t remoteAddr, const void*, size_t dataSize)
+{
+  return dataSize ? this->view(remoteAddr, dataSize) != nullptr : this->isOpen();
+}
+
+std::vector<WinRPM::MappedFileInfo> SnapshotRPM::getMappedFileInfos(std::span<const WinRPM::PathViewType> filenames)
+{
+  auto infos = WinRPM::findMappedFiles(m_regions, filenames);
+  for (size_t i = 0; i < filenames.size(); ++i) {
+    for (const auto& file : m_files) {
+      if (file.name == filenames[i])
+        infos[i].path = file.path;
+    }
+  }
+  return infos;
+}
+
+bool SnapshotRPM::queryRegions(RegionIndex& index)
+{
+  index = m_regions;
+  return this->isOpen();
+}
\ No newline at end of file
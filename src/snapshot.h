@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "rpm.h"
+#include "rpm_backends.h"
+#include "mmap_view.h"
+
+/**
+ * Sparse snapshots of a remote process' address space.
+ *
+ * A snapshot holds the memory regions table of the process, the contents of the remote pages that were touched while
+ * it was being recorded (see: WinRPM::trackTouchedPages), and the contents of the mapped files that are needed locally
+ * (e.g. global-metadata.dat). It can be opened as a remote "process" by SnapshotRPM, so that the il2cpp code can be run
+ * offline, without the game.
+ *
+ * Layout (native byte order, so a snapshot is only meant to be opened on the platform it was captured on):
+ *  SnapshotHeader
+ *  SnapshotRegion[regionCount]
+ *  SnapshotFile[fileCount]
+ *  path::value_type[stringPoolSize]    (the paths of the regions and the names of the files)
+ *  uint64_t[pageCount]                 (the addresses of the captured pages, in ascending order)
+ *  (padding up to a page boundary)
+ *  unsigned char[pageCount][pageSize]  (the contents of the captured pages)
+ *  (the contents of the files)
+ */
+namespace snapshot {
+
+inline constexpr char MAGIC[8] = {'P', 'G', 'V', 'C', 'S', 'N', 'A', 'P'};
+inline constexpr uint32_t VERSION = 2;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t pageSize;
+  uint64_t pid;
+  uint64_t regionCount;
+  uint64_t fileCount;
+  uint64_t stringPoolSize;
+  uint64_t pageCount;
+  uint64_t pageDataOffset; // Page aligned
+};
+
+struct SnapshotRegion {
+  uint64_t start;
+  uint64_t end;
+  uint64_t fileOffset;
+  uint32_t pathOffset; // Into the string pool
+  uint32_t pathSize;
+  uint32_t perms; // RegionIndex::Perms
+  uint32_t reserved;
+};
+
+struct SnapshotFile {
+  uint32_t nameOffset; // Into the string pool
+  uint32_t nameSize;
+  uint64_t dataOffset;
+  uint64_t dataSize;
+  uint64_t dataHash; // FNV-1a of the contents, which names the directory the file is extracted to
+};
+
+/**
+ * A file to be embedded into a snapshot.
+ */
+struct EmbeddedFile {
+  WinRPM::PathViewType name; // Just the filename
+  std::span<const unsigned char> data;
+};
+
+/**
+ * Captures a snapshot of the process opened by rpm: its memory regions, and the current contents of the pages it has
+ * touched so far (which requires WinRPM::trackTouchedPages to have been enabled).
+ */
+bool capture(const std::filesystem::path& snapshotPath, WinRPM& rpm, std::span<const EmbeddedFile> files);
+
+} // namespace snapshot
+
+/**
+ * A read-only backend that serves a snapshot (see: snapshot.h) as if it were a live process. The snapshot is mapped
+ * into memory, so reads are just copies out of the mapping.
+ * Reads of pages that weren't captured fail, and writes are only validated (i.e. they succeed if the pages are in the
+ * snapshot), but then discarded.
+ */
+class SnapshotRPM : public SyncBatchRPM<SnapshotRPM>
+{
+protected:
+  MmapView m_view;
+  const snapshot::SnapshotHeader* m_header = nullptr;
+  std::span<const uint64_t> m_pageAddrs;
+  const unsigned char* m_pageData = nullptr;
+  RegionIndex m_regions;
+
+  // The embedded files, extracted to the temp directory
+  struct ExtractedFile {
+    std::filesystem::path::string_type name;
+    std::filesystem::path path;
+  };
+  std::vector<ExtractedFile> m_files;
+
+public:
+  SnapshotRPM() noexcept = default;
+  ~SnapshotRPM() { this->close(); }
+
+  /**
+   * Opens a snapshot file.
+   */
+  WinRPM::OpenResult open(WinRPM::PathViewType snapshotPath);
+
+  /**
+   * Snapshots have no live processes to open.
+   */
+  inline WinRPM::OpenResult open(PID) { return WinRPM::OpenResult::NotFound; }
+
+  void close();
+  inline bool isOpen() const { return m_header != nullptr; }
+  explicit inline operator bool() const { return isOpen(); }
+  inline bool pollIsOpen() { return this->isOpen(); }
+
+  /**
+   * Returns the PID of the process that the snapshot was captured from.
+   */
+  inline PID getPID() const { return m_header ? (PID)m_header->pid : 0; }
+
+  /**
+   * Returns a pointer to the captured contents of [remoteAddr, remoteAddr + dataSize), or a null pointer if any part
+   * of it wasn't captured. The pointer is valid while the snapshot is open.
+   */
+  const void* view(uintptr_t remoteAddr, size_t dataSize) const;
+
+  bool read_raw(uintptr_t remoteAddr, void* dataOut, size_t dataSize);
+  bool write_raw(uintptr_t remoteAddr, const void* dataIn, size_t dataSize);
+
+  /**
+   * See: WinRPM::getMappedFileInfos
+   * The embedded files are reported with the path they were extracted to.
+   */
+  std::vector<WinRPM::MappedFileInfo> getMappedFileInfos(std::span<const WinRPM::PathViewType> filenames);
+
+  /**
+   * Returns the regions table of the snapshot.
+   */
+  bool queryRegions(RegionIndex& index);
+};
+
+static_assert(RPMBackend<SnapshotRPM>);
\ No newline at end of file